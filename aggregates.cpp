@@ -0,0 +1,68 @@
+#include "aggregates.h"
+#include <algorithm>
+#include "catalog.h"
+#include "cow.h"
+
+void DurationAggregates::add(uint32_t id, const show& s) {
+    vector<uint32_t>& ids = unshare(byDuration[s.duration]);
+    // IDs are handed out in increasing order, so this is almost always an append
+    ids.insert(upper_bound(ids.begin(), ids.end(), id), id);
+    sum += s.duration;
+    count++;
+
+    if (s.category >= byCategory.size()) byCategory.resize(s.category + 1);
+    Running& c = unshare(byCategory[s.category]);
+    c.sum += s.duration;
+    c.count++;
+    c.durations[s.duration]++;
+}
+
+void DurationAggregates::remove(uint32_t id, const show& s) {
+    auto list = byDuration.find(s.duration);
+    if (list == byDuration.end() || !binary_search(list->second->begin(), list->second->end(), id)) return;
+    vector<uint32_t>& ids = unshare(list->second);
+    ids.erase(lower_bound(ids.begin(), ids.end(), id));
+    if (ids.empty()) byDuration.erase(list);
+    sum -= s.duration;
+    count--;
+
+    Running& c = unshare(byCategory[s.category]);
+    c.sum -= s.duration;
+    c.count--;
+    auto it = c.durations.find(s.duration);
+    if (--it->second == 0) c.durations.erase(it);
+}
+
+void DurationAggregates::remap(const vector<uint32_t>& newIds) {
+    // Compaction keeps the relative order of IDs, so the lists stay sorted
+    for (auto& [duration, ids] : byDuration) {
+        for (auto& id : unshare(ids)) id = newIds[id];
+    }
+}
+
+DurationStats DurationAggregates::all() const {
+    DurationStats stats;
+    if (byDuration.empty()) return stats;
+    stats.sum = sum;
+    stats.count = count;
+    stats.min = byDuration.begin()->first;
+    stats.max = byDuration.rbegin()->first;
+    return stats;
+}
+
+DurationStats DurationAggregates::category(CategoryId id) const {
+    DurationStats stats;
+    if (id >= byCategory.size() || !byCategory[id] || byCategory[id]->count == 0) return stats;
+    const Running& c = *byCategory[id];
+    stats.sum = c.sum;
+    stats.count = c.count;
+    stats.min = c.durations.begin()->first;
+    stats.max = c.durations.rbegin()->first;
+    return stats;
+}
+
+span<const uint32_t> DurationAggregates::withDuration(int32_t duration) const {
+    auto list = byDuration.find(duration);
+    if (list == byDuration.end()) return {};
+    return *list->second;
+}
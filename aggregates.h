@@ -0,0 +1,49 @@
+#ifndef AGGREGATES_H
+#define AGGREGATES_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <span>
+#include <vector>
+#include "columnar.h"
+#include "intern.h"
+
+using namespace std;
+
+struct show;
+
+// Running duration statistics over all shows and per category, updated in
+// O(log n) on every insert, update and erase (an erase also shifts one
+// duration's ID list) so that min/max/average never need a pass over the
+// table. The shows are also listed by duration, which is how the longest and
+// shortest are found. The lists and the per-category entries are
+// copy-on-write, so copies share the ones neither side changed.
+class DurationAggregates {
+public:
+    void add(uint32_t id, const show& s);
+    void remove(uint32_t id, const show& s);
+    void remap(const vector<uint32_t>& newIds);     // after the catalog compacts
+
+    DurationStats all() const;
+    DurationStats category(CategoryId id) const;    // empty stats for unknown IDs
+    size_t categoryCount() const { return byCategory.size(); }   // upper bound on CategoryIds in use
+
+    // IDs of the shows lasting exactly duration minutes, in id order, read in
+    // place; valid until the aggregates next change
+    span<const uint32_t> withDuration(int32_t duration) const;
+
+private:
+    struct Running {
+        int64_t sum = 0;
+        uint32_t count = 0;
+        map<int32_t, uint32_t> durations;   // duration -> how many shows have it
+    };
+
+    map<int32_t, shared_ptr<vector<uint32_t>>> byDuration;     // show IDs in order, never empty
+    int64_t sum = 0;
+    uint32_t count = 0;
+    vector<shared_ptr<Running>> byCategory;     // indexed by CategoryId; null while unused
+};
+
+#endif // AGGREGATES_H
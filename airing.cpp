@@ -0,0 +1,161 @@
+#include "airing.h"
+#include <algorithm>
+#include "catalog.h"
+#include "cow.h"
+
+static constexpr uint32_t bucketCount = minutesPerWeek / AiringIndex::bucketMinutes;
+
+AiringIndex::AiringIndex() : buckets(bucketCount) {}
+
+AiringIndex::Bucket::Bucket(const Bucket& other) {
+    groups.reserve(other.groups.size());
+    for (const auto& group : other.groups) groups.push_back({group.channel, {group.entries, &arena}});
+}
+
+const AiringIndex::Bucket& AiringIndex::bucketAt(uint32_t b) const {
+    static const Bucket empty;
+    return buckets[b] ? *buckets[b] : empty;
+}
+
+int airIntervals(const show& s, AirInterval out[2]) {
+    if (s.duration <= 0) return 0;
+    uint32_t start = minuteOfWeek(s.dayOfWeek, s.startHour, s.startMinute);
+    if (static_cast<uint32_t>(s.duration) >= minutesPerWeek) {
+        out[0] = {0, minutesPerWeek};
+        return 1;
+    }
+    uint32_t end = start + s.duration;
+    if (end <= minutesPerWeek) {
+        out[0] = {start, end};
+        return 1;
+    }
+    out[0] = {start, minutesPerWeek};
+    out[1] = {0, end - minutesPerWeek};
+    return 2;
+}
+
+static bool byShow(const auto& entry, uint32_t id) {
+    return entry.show < id;
+}
+
+static bool byChannel(const auto& group, uint32_t channel) {
+    return group.channel < channel;
+}
+
+template <typename G>
+auto AiringIndex::findGroup(G& groups, uint32_t channel) {
+    auto group = lower_bound(groups.begin(), groups.end(), channel, byChannel<Group>);
+    return group != groups.end() && group->channel == channel ? group : groups.end();
+}
+
+void AiringIndex::add(uint32_t id, const show& s) {
+    AirInterval pieces[2];
+    int count = airIntervals(s, pieces);
+    for (int p = 0; p < count; ++p) {
+        Entry entry {id, static_cast<uint16_t>(pieces[p].start), static_cast<uint16_t>(pieces[p].end)};
+        for (uint32_t b = entry.start / bucketMinutes; b <= (entry.end - 1u) / bucketMinutes; ++b) {
+            Bucket& bucket = unshare(buckets[b]);
+            auto slot = lower_bound(bucket.groups.begin(), bucket.groups.end(), s.channelCode, byChannel<Group>);
+            if (slot == bucket.groups.end() || slot->channel != s.channelCode) {
+                slot = bucket.groups.insert(slot, Group {s.channelCode, pmr::vector<Entry>(&bucket.arena)});
+            }
+            pmr::vector<Entry>& group = slot->entries;
+            // IDs are handed out in increasing order, so this is almost always an append
+            if (group.empty() || group.back().show < id) {
+                group.push_back(entry);
+            } else {
+                group.insert(lower_bound(group.begin(), group.end(), id, byShow<Entry>), entry);
+            }
+        }
+    }
+}
+
+void AiringIndex::remove(uint32_t id, const show& s) {
+    AirInterval pieces[2];
+    int count = airIntervals(s, pieces);
+    for (int p = 0; p < count; ++p) {
+        for (uint32_t b = pieces[p].start / bucketMinutes; b <= (pieces[p].end - 1) / bucketMinutes; ++b) {
+            if (!buckets[b]) continue;
+            Bucket& bucket = unshare(buckets[b]);
+            auto group = findGroup(bucket.groups, s.channelCode);
+            if (group == bucket.groups.end()) continue;
+            auto at = lower_bound(group->entries.begin(), group->entries.end(), id, byShow<Entry>);
+            if (at == group->entries.end() || at->show != id) continue;
+            group->entries.erase(at);
+            if (group->entries.empty()) bucket.groups.erase(group);
+        }
+    }
+}
+
+void AiringIndex::remap(const vector<uint32_t>& newIds) {
+    // Compaction keeps the relative order of IDs, so groups stay sorted
+    for (auto& shared : buckets) {
+        if (!shared) continue;
+        for (auto& group : unshare(shared).groups) {
+            for (auto& entry : group.entries) entry.show = newIds[entry.show];
+        }
+    }
+}
+
+// Calls f for each entry of a bucket, or only those of one channel
+template <typename F>
+void AiringIndex::forEachEntry(const Bucket& bucket, optional<uint32_t> channel, F&& f) const {
+    if (!channel) {
+        for (const auto& group : bucket.groups) {
+            for (const auto& entry : group.entries) f(entry);
+        }
+        return;
+    }
+    auto group = findGroup(bucket.groups, *channel);
+    if (group == bucket.groups.end()) return;
+    for (const auto& entry : group->entries) f(entry);
+}
+
+void AiringIndex::airingAt(uint32_t at, vector<uint32_t>& out, optional<uint32_t> channel) const {
+    out.clear();
+    if (at >= minutesPerWeek) return;
+    forEachEntry(bucketAt(at / bucketMinutes), channel, [&](const Entry& e) {
+        if (e.start <= at && at < e.end) out.push_back(e.show);
+    });
+}
+
+// Appends the shows overlapping [from, to), a window inside the week. A show
+// touching several buckets is reported only from the first bucket the
+// overlap falls in. Returns whether a piece ending at Sunday midnight (and so
+// possibly one half of a wrapped broadcast) was reported.
+bool AiringIndex::collect(uint32_t from, uint32_t to, vector<uint32_t>& out, optional<uint32_t> channel) const {
+    bool weekEnd = false;
+    for (uint32_t b = from / bucketMinutes; b <= (to - 1) / bucketMinutes; ++b) {
+        forEachEntry(bucketAt(b), channel, [&](const Entry& e) {
+            if (e.start >= to || e.end <= from) return;
+            if (max<uint32_t>(e.start, from) / bucketMinutes != b) return;
+            out.push_back(e.show);
+            weekEnd |= e.end == minutesPerWeek;
+        });
+    }
+    return weekEnd;
+}
+
+void AiringIndex::airingDuring(uint32_t from, uint32_t length, vector<uint32_t>& out,
+                               optional<uint32_t> channel) const {
+    if (length == 0) {
+        airingAt(from, out, channel);
+        return;
+    }
+    out.clear();
+    if (from >= minutesPerWeek) return;
+
+    uint32_t to = from + min(length, minutesPerWeek);
+    bool duplicates = collect(from, min(to, minutesPerWeek), out, channel);
+    if (to > minutesPerWeek && from > 0) {
+        collect(0, min(to - minutesPerWeek, from), out, channel);
+        duplicates = true;
+    }
+
+    // Both halves of a broadcast split at Sunday midnight, or a long one
+    // spanning both halves of a wrapped window, may have matched twice
+    if (duplicates) {
+        sort(out.begin(), out.end());
+        out.erase(unique(out.begin(), out.end()), out.end());
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef AIRING_H
+#define AIRING_H
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+#include "arena.h"
+#include "intern.h"
+#include "schedule.h"
+
+using namespace std;
+
+struct show;
+
+constexpr uint32_t minutesPerWeek = daysPerWeek * minutesPerDay;
+
+inline uint32_t minuteOfWeek(Day day, int hour, int minute) {
+    return static_cast<uint32_t>(day) * minutesPerDay + hour * 60 + minute;
+}
+
+// The part of a broadcast inside the week, [start, end) in minutes of the week
+struct AirInterval {
+    uint32_t start;
+    uint32_t end;
+};
+
+// A broadcast's airtime as one interval, or two when it runs past Sunday
+// midnight and wraps round to Monday morning. Returns how many were written.
+int airIntervals(const show& s, AirInterval out[2]);
+
+// Interval index answering "what is on the air" over the weekly grid. Every
+// broadcast is the interval [start, start + duration) in minutes of the week;
+// one that runs past Sunday midnight wraps round to Monday morning. Intervals
+// are registered in each fixed-width time bucket they touch. Inside a bucket
+// they are grouped by channel, with the groups sorted by channel so a channel
+// filter is a binary search. Each group is kept in ID order, so loading a
+// catalog only ever appends. Buckets are copy-on-write, so a copy of the
+// index shares every bucket neither side has changed, and each allocates
+// from an arena of its own rather than once per group.
+class AiringIndex {
+public:
+    static constexpr uint32_t bucketMinutes = 15;
+
+    AiringIndex();
+
+    void add(uint32_t id, const show& s);
+    void remove(uint32_t id, const show& s);
+    void remap(const vector<uint32_t>& newIds);     // after Catalog compaction
+
+    // Replace out with the IDs of the shows on the air at the given minute of
+    // the week, or overlapping [from, from + length), in no particular order.
+    // Reusing out between calls keeps queries allocation-free. Without a
+    // channel every channel is included.
+    void airingAt(uint32_t at, vector<uint32_t>& out, optional<uint32_t> channel = nullopt) const;
+    void airingDuring(uint32_t from, uint32_t length, vector<uint32_t>& out,
+                      optional<uint32_t> channel = nullopt) const;
+
+private:
+    struct Entry {
+        uint32_t show;
+        uint16_t start;         // [start, end) in minutes of the week
+        uint16_t end;
+    };
+    struct Group {
+        uint32_t channel;               // ChannelCodeId
+        pmr::vector<Entry> entries;     // in the bucket's arena
+    };
+    // Each group's entries live in its bucket's own arena, in place of one
+    // heap allocation per group. Copying a bucket packs them into a fresh one.
+    struct Bucket {
+        Bucket() = default;
+        Bucket(const Bucket& other);
+
+        Arena arena {4096, 256 << 10};
+        vector<Group> groups;           // sorted by channel
+    };
+
+    template <typename G>
+    static auto findGroup(G& groups, uint32_t channel);     // end() if absent
+
+    template <typename F>
+    void forEachEntry(const Bucket& bucket, optional<uint32_t> channel, F&& f) const;
+    bool collect(uint32_t from, uint32_t to, vector<uint32_t>& out, optional<uint32_t> channel) const;
+    const Bucket& bucketAt(uint32_t b) const;
+
+    vector<shared_ptr<Bucket>> buckets;     // null while empty
+};
+
+#endif // AIRING_H
@@ -0,0 +1,145 @@
+#include "arena.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <new>
+
+static atomic<bool> arenasOn {true};
+
+void setArenasEnabled(bool enabled) {
+    arenasOn = enabled;
+}
+
+bool arenasEnabled() {
+    return arenasOn;
+}
+
+Arena::Arena(size_t firstBlock, size_t maxBlock)
+    : pooled(arenasOn), nextBlock(max<size_t>(firstBlock, 64)), maxBlock(max(maxBlock, firstBlock)) {}
+
+Arena::~Arena() {
+    for (const Block& b : blocks) ::operator delete(b.data);
+}
+
+string_view Arena::copy(string_view s) {
+    if (s.empty()) return {};
+    usedBytes += s.size();
+    char* p;
+    if (pooled) {
+        p = static_cast<char*>(bump(s.size(), 1));      // freed only with the arena, so no size class
+    } else {
+        p = static_cast<char*>(::operator new(s.size()));
+        blocks.push_back({p, s.size()});
+        reservedBytes += s.size();
+    }
+    memcpy(p, s.data(), s.size());
+    return {p, s.size()};
+}
+
+void Arena::reset() {
+    ranges::fill(freeLists, nullptr);
+    usedBytes = 0;
+    if (!pooled) {
+        for (const Block& b : blocks) ::operator delete(b.data);
+        blocks.clear();
+        reservedBytes = 0;
+    }
+    if (blocks.empty()) return;
+    auto largest = ranges::max_element(blocks, {}, &Block::size);
+    Block kept = *largest;
+    blocks.erase(largest);
+    for (const Block& b : blocks) ::operator delete(b.data);
+    blocks.assign(1, kept);
+    cursor = kept.data;
+    limit = kept.data + kept.size;
+    reservedBytes = kept.size;
+}
+
+size_t Arena::sizeClass(size_t bytes) {
+    if (bytes <= 256) return bytes == 0 ? 0 : (bytes - 1) / 16;
+    return 16 + static_cast<size_t>(bit_width(bytes - 1)) - 9;
+}
+
+size_t Arena::classBytes(size_t sizeClass) {
+    return sizeClass < 16 ? (sizeClass + 1) * 16 : size_t(512) << (sizeClass - 16);
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+    if (!pooled) {
+        usedBytes += bytes;
+        if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) return ::operator new(bytes);
+        return ::operator new(bytes, align_val_t(alignment));
+    }
+    if (!pooledSize(bytes, alignment)) {
+        usedBytes += bytes;
+        return bump(bytes, alignment);
+    }
+    size_t c = sizeClass(bytes);
+    usedBytes += classBytes(c);
+    if (void* piece = freeLists[c]) {
+        memcpy(&freeLists[c], piece, sizeof(void*));
+        return piece;
+    }
+    return bump(classBytes(c), 16);
+}
+
+void Arena::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    if (!pooled) {
+        usedBytes -= bytes;
+        if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            ::operator delete(p);
+        } else {
+            ::operator delete(p, align_val_t(alignment));
+        }
+        return;
+    }
+    if (!pooledSize(bytes, alignment)) {
+        usedBytes -= bytes;
+        return;
+    }
+    size_t c = sizeClass(bytes);
+    usedBytes -= classBytes(c);
+    memcpy(p, &freeLists[c], sizeof(void*));
+    freeLists[c] = p;
+}
+
+// Pads the cursor up to the alignment, which may exceed that of the block
+// itself; grow leaves room for the padding
+void* Arena::bump(size_t bytes, size_t alignment) {
+    auto at = reinterpret_cast<uintptr_t>(cursor);
+    uintptr_t aligned = (at + alignment - 1) & ~(uintptr_t(alignment) - 1);
+    if (cursor && aligned + bytes <= reinterpret_cast<uintptr_t>(limit)) {
+        cursor = reinterpret_cast<char*>(aligned + bytes);
+        return reinterpret_cast<void*>(aligned);
+    }
+    return grow(bytes, alignment);
+}
+
+// Starts a new block big enough for the request; the rest of the current
+// block is abandoned
+void* Arena::grow(size_t bytes, size_t alignment) {
+    size_t size = max(nextBlock, bytes + alignment);
+    nextBlock = min(nextBlock * 2, maxBlock);
+    char* data = static_cast<char*>(::operator new(size));
+    blocks.push_back({data, size});
+    reservedBytes += size;
+    cursor = data;
+    limit = data + size;
+    return bump(bytes, alignment);
+}
+
+static thread_local Arena scratchArena(64 << 10, 4 << 20);
+static thread_local unsigned scratchDepth = 0;
+
+ScratchScope::ScratchScope() {
+    scratchDepth++;
+}
+
+ScratchScope::~ScratchScope() {
+    if (--scratchDepth == 0) scratchArena.reset();
+}
+
+Arena& ScratchScope::arena() {
+    return scratchArena;
+}
@@ -0,0 +1,89 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Arena with size-class pools: hands out memory from a few large blocks and
+// frees it all at once, so filling a container costs a handful of block
+// allocations instead of one per element. Pieces of up to 64 KiB are rounded
+// to a size class, and freeing one puts it on that class's free list for the
+// next request of the size, so vectors growing inside the arena reuse what
+// they left behind. Anything bigger is only reclaimed when the arena is reset
+// or destroyed. Not thread-safe.
+//
+// Blocks start at firstBlock bytes and double up to maxBlock, so a small
+// arena stays small. With arenas disabled (see setArenasEnabled) an arena
+// passes every request straight through to new/delete instead.
+class Arena : public pmr::memory_resource {
+public:
+    explicit Arena(size_t firstBlock = 4096, size_t maxBlock = 1 << 20);
+    ~Arena() override;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // A copy of s that lasts until the arena is reset or destroyed
+    string_view copy(string_view s);
+
+    // Frees everything; the largest block is kept for the next round
+    void reset();
+
+    size_t used() const { return usedBytes; }           // handed out and not freed
+    size_t reserved() const { return reservedBytes; }   // held in blocks
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    struct Block {
+        char* data;
+        size_t size;
+    };
+
+    // 16-byte steps up to 256 bytes, then powers of two up to 64 KiB
+    static constexpr size_t classCount = 24;
+    static constexpr size_t largestClass = 64 << 10;
+    static bool pooledSize(size_t bytes, size_t alignment) { return bytes <= largestClass && alignment <= 16; }
+    static size_t sizeClass(size_t bytes);
+    static size_t classBytes(size_t sizeClass);
+
+    void* bump(size_t bytes, size_t alignment);
+    void* grow(size_t bytes, size_t alignment);
+
+    const bool pooled;      // decided at construction, so memory is always freed the way it was allocated
+    size_t nextBlock;
+    size_t maxBlock;
+    vector<Block> blocks;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    void* freeLists[classCount] = {};      // each free piece holds the next one's address
+    size_t usedBytes = 0;
+    size_t reservedBytes = 0;
+};
+
+// Arenas are on by default. Turning them off (before any catalog is loaded)
+// makes every container allocate element by element, as it would without
+// them, to compare the two.
+void setArenasEnabled(bool enabled);
+bool arenasEnabled();
+
+// Per-thread scratch arena for the temporaries of one call, such as a query's
+// candidate rows. It is reset when the outermost scope on the thread ends,
+// so its blocks are reused call after call instead of freed and allocated
+// again. Nothing allocated from it may outlive the scope.
+class ScratchScope {
+public:
+    ScratchScope();
+    ~ScratchScope();
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    Arena& arena();
+};
+
+#endif // ARENA_H
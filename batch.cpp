@@ -0,0 +1,164 @@
+#include "batch.h"
+#include "conflicts.h"
+
+void CatalogBatch::insertShow(show s) {
+    ops.push_back({Op::InsertShow, {}, move(s), {}});
+}
+
+void CatalogBatch::updateShow(string name, show s) {
+    ops.push_back({Op::UpdateShow, move(name), move(s), {}});
+}
+
+void CatalogBatch::eraseShow(string name) {
+    ops.push_back({Op::EraseShow, move(name), {}, {}});
+}
+
+void CatalogBatch::insertChannel(channel c) {
+    ops.push_back({Op::InsertChannel, {}, {}, move(c)});
+}
+
+void CatalogBatch::updateChannel(channel c) {
+    string code = c.code;
+    ops.push_back({Op::UpdateChannel, move(code), {}, move(c)});
+}
+
+void CatalogBatch::eraseChannel(string code, ChannelErase mode) {
+    ops.push_back({Op::EraseChannel, move(code), {}, {}, mode});
+}
+
+// Checks one show against the scratch catalog; ignore is the show it replaces
+static bool validShow(const Catalog& scratch, const show& s, ShowId ignore, string& error) {
+    if (s.duration <= 0) {
+        error = "show " + s.name + " has no duration";
+        return false;
+    }
+    if (scratch.findChannelByCodeId(s.channelCode) == noChannel) {
+        error = "show " + s.name + " uses unknown channel code " + channelCodes.str(s.channelCode);
+        return false;
+    }
+    vector<ShowId> overlapping = conflictingShows(scratch, s, ignore);
+    if (!overlapping.empty()) {
+        error = "show " + s.name + " overlaps " + scratch.getShow(overlapping.front()).name;
+        return false;
+    }
+    return true;
+}
+
+bool CatalogBatch::apply(Catalog& scratch, const Staged& staged, string& error) const {
+    switch (staged.op) {
+        case Op::InsertShow:
+            if (scratch.hasShow(staged.s.name)) {
+                error = "show " + staged.s.name + " already exists";
+                return false;
+            }
+            if (!validShow(scratch, staged.s, noShow, error)) return false;
+            scratch.insertShow(staged.s);
+            return true;
+        case Op::UpdateShow: {
+            ShowId id = scratch.findShow(staged.key);
+            if (id == noShow) {
+                error = "show " + staged.key + " does not exist";
+                return false;
+            }
+            if (!validShow(scratch, staged.s, id, error)) return false;
+            if (!scratch.updateShow(id, staged.s)) {
+                error = "show " + staged.s.name + " already exists";
+                return false;
+            }
+            return true;
+        }
+        case Op::EraseShow: {
+            ShowId id = scratch.findShow(staged.key);
+            if (id == noShow) {
+                error = "show " + staged.key + " does not exist";
+                return false;
+            }
+            scratch.eraseShow(id);
+            return true;
+        }
+        case Op::InsertChannel:
+            if (scratch.insertChannel(staged.c) == noChannel) {
+                error = "channel code " + staged.c.code + " or name " + staged.c.name + " already exists";
+                return false;
+            }
+            return true;
+        case Op::UpdateChannel: {
+            ChannelId id = scratch.findChannelByCode(staged.key);
+            if (id == noChannel) {
+                error = "channel " + staged.key + " does not exist";
+                return false;
+            }
+            if (!scratch.updateChannel(id, staged.c)) {
+                error = "channel name " + staged.c.name + " already exists";
+                return false;
+            }
+            return true;
+        }
+        case Op::EraseChannel: {
+            ChannelId id = scratch.findChannelByCode(staged.key);
+            if (id == noChannel) {
+                error = "channel " + staged.key + " does not exist";
+                return false;
+            }
+            size_t dependents = scratch.showsOnChannel(channelCodes.find(staged.key)).size();
+            if (!scratch.eraseChannel(id, staged.mode)) {
+                error = "channel " + staged.key + " still has " + to_string(dependents) + " shows";
+                return false;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CatalogBatch::log(Journal& journal, const Staged& staged) {
+    switch (staged.op) {
+        case Op::InsertShow: return journal.logInsertShow(staged.s);
+        case Op::UpdateShow: return journal.logUpdateShow(staged.key, staged.s);
+        case Op::EraseShow: return journal.logDeleteShow(staged.key);
+        case Op::InsertChannel: return journal.logInsertChannel(staged.c);
+        case Op::UpdateChannel: return journal.logUpdateChannel(staged.c);
+        case Op::EraseChannel: return journal.logDeleteChannel(staged.key);
+    }
+    return false;
+}
+
+bool CatalogBatch::commit(Catalog& target, Journal& journal, vector<string>& errors) {
+    errors.clear();
+    Catalog scratch = target;
+    scratch.reserve(scratch.showCount() + ops.size(), scratch.channelCount());
+
+    // Keep going after a failure so the caller sees every problem at once
+    string error;
+    for (size_t i = 0; i < ops.size(); ++i) {
+        if (!apply(scratch, ops[i], error)) {
+            errors.push_back("operation " + to_string(i + 1) + ": " + error);
+        }
+    }
+    if (!errors.empty()) return false;
+
+    journal.beginBatch();
+    for (const auto& staged : ops) log(journal, staged);
+    if (!journal.endBatch()) {
+        errors.push_back("could not write the journal");
+        return false;
+    }
+
+    target = move(scratch);
+    ops.clear();
+    return true;
+}
+
+bool CatalogBatch::applyInPlace(Catalog& target, Journal& journal, string& error) {
+    // Each operation checks everything before touching target, so a failed
+    // one leaves it as it was
+    for (const auto& staged : ops) {
+        if (!apply(target, staged, error)) return false;
+        if (!log(journal, staged)) {
+            error = "could not write the journal";
+            return false;
+        }
+    }
+    ops.clear();
+    return true;
+}
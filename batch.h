@@ -0,0 +1,65 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "catalog.h"
+#include "journal.h"
+
+using namespace std;
+
+// Stages show and channel mutations and applies them all or nothing. commit
+// runs the operations in order on a scratch copy of the catalog, checking
+// each one against the state the earlier ones left behind. If every one
+// passes, the whole batch reaches the journal as a single write and, once
+// that succeeds, the copy replaces the catalog. Otherwise the catalog is left
+// untouched and errors lists every operation that failed (or the failed
+// journal write).
+class CatalogBatch {
+public:
+    void insertShow(show s);
+    void updateShow(string name, show s);       // the show currently called name
+    void eraseShow(string name);
+    void insertChannel(channel c);
+    void updateChannel(channel c);              // keyed by code
+    void eraseChannel(string code, ChannelErase mode = ChannelErase::Refuse);
+
+    size_t size() const { return ops.size(); }
+    bool empty() const { return ops.empty(); }
+    void clear() { ops.clear(); }
+
+    bool commit(Catalog& target, Journal& journal, vector<string>& errors);
+
+    // Runs the operations straight on target without a scratch copy,
+    // stopping at the first failure; those before it stay applied and logged.
+    // An operation the journal could not take stays applied to target, so
+    // this is meant for callers that work on a private copy of the catalog
+    // and drop it when this fails.
+    bool applyInPlace(Catalog& target, Journal& journal, string& error);
+
+private:
+    enum class Op : uint8_t {
+        InsertShow,
+        UpdateShow,
+        EraseShow,
+        InsertChannel,
+        UpdateChannel,
+        EraseChannel
+    };
+
+    struct Staged {
+        Op op;
+        string key;         // current show name or channel code
+        show s {};
+        channel c {};
+        ChannelErase mode = ChannelErase::Refuse;
+    };
+
+    bool apply(Catalog& scratch, const Staged& staged, string& error) const;
+    static bool log(Journal& journal, const Staged& staged);
+
+    vector<Staged> ops;
+};
+
+#endif // BATCH_H
@@ -0,0 +1,436 @@
+// Benchmark suite: generates catalogs of the requested sizes and times the
+// startup load, show edits and reports on each, through the same functions
+// the program itself uses. Build with optimizations (CMAKE_BUILD_TYPE=Release).
+//
+//   PracticaBench [--shows N[,N...]] [--runs N] [--ops N] [--seed N]
+//                 [--dir DIR] [--format json|csv|text] [--arena on|off]
+//   PracticaBench generate SHOWS [DIR [SEED]]
+//
+// Sizes take k and M suffixes (1k ... 10M). Results go to stdout, one row per
+// benchmark and size, with calls and rows per second, call latency
+// percentiles, heap allocations and bytes per call, and the process's peak
+// RSS so far; sizes run smallest first, so that is close to the peak of the
+// current size. --arena off runs with the index arenas disabled, to compare.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include "arena.h"
+#include "generator.h"
+#include "loader.h"
+#include "table.h"
+#include "tvmodule.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+using Clock = chrono::steady_clock;
+
+// Every heap allocation the process makes goes through these, so a benchmark
+// can count the ones its calls make
+static atomic<uint64_t> heapAllocations {0};
+static atomic<uint64_t> heapBytes {0};
+
+static void* countedAlloc(size_t bytes, size_t alignment) {
+    heapAllocations.fetch_add(1, memory_order_relaxed);
+    heapBytes.fetch_add(bytes, memory_order_relaxed);
+    if (bytes == 0) bytes = 1;
+    void* p;
+    if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        p = malloc(bytes);
+    } else {
+#ifdef _WIN32
+        p = _aligned_malloc(bytes, alignment);
+#else
+        p = aligned_alloc(alignment, (bytes + alignment - 1) / alignment * alignment);
+#endif
+    }
+    if (!p) throw bad_alloc();
+    return p;
+}
+
+static void countedFree(void* p, size_t alignment) {
+#ifdef _WIN32
+    if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        _aligned_free(p);
+        return;
+    }
+#endif
+    (void)alignment;
+    free(p);
+}
+
+void* operator new(size_t bytes) {
+    return countedAlloc(bytes, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void* operator new(size_t bytes, align_val_t alignment) {
+    return countedAlloc(bytes, static_cast<size_t>(alignment));
+}
+void operator delete(void* p) noexcept {
+    countedFree(p, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void operator delete(void* p, size_t) noexcept {
+    countedFree(p, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void operator delete(void* p, align_val_t alignment) noexcept {
+    countedFree(p, static_cast<size_t>(alignment));
+}
+void operator delete(void* p, size_t, align_val_t alignment) noexcept {
+    countedFree(p, static_cast<size_t>(alignment));
+}
+
+struct BenchOptions {
+    vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+    size_t runs = 5;            // samples per report and load benchmark
+    size_t ops = 1000;          // shows added, edited and deleted
+    uint64_t seed = 1;
+    string dir = "bench-data";
+    TableFormat format = TableFormat::Json;
+    bool arenas = true;
+};
+
+// Call latencies of one benchmark, in microseconds, and the heap
+// allocations the calls made
+struct Samples {
+    vector<double> micros;
+    size_t rowsPerCall = 1;
+    size_t failed = 0;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+
+    template <typename F>
+    void time(F&& f) {
+        micros.reserve(micros.size() + 1);      // not to count the sample's own allocation
+        uint64_t allocationsBefore = heapAllocations.load(memory_order_relaxed);
+        uint64_t bytesBefore = heapBytes.load(memory_order_relaxed);
+        auto start = Clock::now();
+        f();
+        auto elapsed = Clock::now() - start;
+        allocations += heapAllocations.load(memory_order_relaxed) - allocationsBefore;
+        allocatedBytes += heapBytes.load(memory_order_relaxed) - bytesBefore;
+        micros.push_back(chrono::duration<double, micro>(elapsed).count());
+    }
+};
+
+// Swallows everything the timed functions print
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+static size_t peakRssKb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof counters)) return 0;
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss) / 1024;     // bytes on macOS
+#else
+    return static_cast<size_t>(usage.ru_maxrss);
+#endif
+#endif
+}
+
+static Table resultTable() {
+    return Table({{"Benchmark", "benchmark"},
+                  {"Shows", "shows", "", true},
+                  {"Calls", "calls", "", true},
+                  {"Seconds", "seconds", "", true},
+                  {"Calls/s", "calls_per_sec", "", true},
+                  {"Rows/s", "rows_per_sec", "", true},
+                  {"p50", "p50_us", " us", true},
+                  {"p90", "p90_us", " us", true},
+                  {"p99", "p99_us", " us", true},
+                  {"Max", "max_us", " us", true},
+                  {"Allocs/call", "allocs_per_call", "", true},
+                  {"Bytes/call", "alloc_bytes_per_call", " B", true},
+                  {"Peak RSS", "peak_rss_kb", " KB", true},
+                  {"Failed", "failed", "", true}});
+}
+
+// Nearest-rank percentile of sorted samples
+static double percentile(const vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t rank = static_cast<size_t>(p / 100 * static_cast<double>(sorted.size()) + 0.999999);
+    return sorted[min(sorted.size(), max<size_t>(rank, 1)) - 1];
+}
+
+static string decimal(double value, int places) {
+    ostringstream text;
+    text << fixed << setprecision(places) << value;
+    return text.str();
+}
+
+static void addResult(Table& table, const string& name, size_t shows, Samples samples) {
+    vector<double>& sorted = samples.micros;
+    sort(sorted.begin(), sorted.end());
+    double total = 0;
+    for (double us : sorted) total += us;
+    double seconds = total / 1e6;
+    double calls = static_cast<double>(sorted.size());
+    table.cell(name).number(static_cast<int64_t>(shows)).number(static_cast<int64_t>(sorted.size()));
+    table.cell(decimal(seconds, 6));
+    table.number(seconds > 0 ? static_cast<int64_t>(calls / seconds) : 0);
+    table.number(seconds > 0 ? static_cast<int64_t>(calls * static_cast<double>(samples.rowsPerCall) / seconds) : 0);
+    for (double p : {50.0, 90.0, 99.0, 100.0}) table.cell(decimal(percentile(sorted, p), 1));
+    uint64_t perCall = max<uint64_t>(1, sorted.size());
+    table.number(static_cast<int64_t>(samples.allocations / perCall));
+    table.number(static_cast<int64_t>(samples.allocatedBytes / perCall));
+    table.number(static_cast<int64_t>(peakRssKb())).number(static_cast<int64_t>(samples.failed));
+}
+
+// Runs f with cout silenced; with output set, cout goes there instead
+template <typename F>
+static void quietly(F&& f, ostream* output = nullptr) {
+    static NullBuffer discard;
+    streambuf* saved = cout.rdbuf(output ? output->rdbuf() : &discard);
+    f();
+    cout.rdbuf(saved);
+}
+
+// The startup path of main.cpp: both text files, then the journal
+static void benchLoad(Table& table, size_t shows, const BenchOptions& options) {
+    Samples samples;
+    samples.rowsPerCall = shows;
+    for (size_t run = 0; run < options.runs; ++run) {
+        Catalog loaded;
+        samples.time([&] {
+            loadPrograms("Program.txt", loaded);
+            loadChannels("Channel.txt", loaded);
+            size_t skipped = 0;
+            journal.replay(loaded, skipped);
+        });
+        catalog = move(loaded);
+    }
+    addResult(table, "load", shows, move(samples));
+}
+
+// Each of addShow, editShow and deleteShow on its own shows, one minute long
+// and a minute apart on a channel of their own so they never conflict
+static void benchEdits(Table& table, size_t shows, const BenchOptions& options) {
+    string code = generateNextChannelId();
+    quietly([] { addChannel("Bench channel", "Romania"); });
+    size_t ops = min<size_t>(options.ops, minutesPerWeek);
+
+    auto slot = [](size_t i, string& time, string& day) {
+        time = formatStartTime(static_cast<int>(i % 1440 / 60), static_cast<int>(i % 60));
+        day = dayName(static_cast<Day>(i / 1440));
+    };
+    auto succeeded = [](const ostringstream& output) { return output.str().find("successfully") != string::npos; };
+
+    Samples adds, edits, deletes;
+    string time, day;
+    for (size_t i = 0; i < ops; ++i) {
+        slot(i, time, day);
+        string name = "Bench show " + to_string(i);
+        ostringstream output;
+        quietly([&] { adds.time([&] { addShow(name, "Stiri", time, 1, day, code); }); }, &output);
+        if (!succeeded(output)) adds.failed++;
+    }
+    for (size_t i = 0; i < ops; ++i) {
+        slot(i, time, day);
+        string name = "Bench show " + to_string(i);
+        ostringstream output;
+        quietly([&] { edits.time([&] { editShow(name, name + " edited", "Film", time, 1, day, code); }); }, &output);
+        if (!succeeded(output)) edits.failed++;
+    }
+    for (size_t i = 0; i < ops; ++i) {
+        string name = "Bench show " + to_string(i) + " edited";
+        ostringstream output;
+        quietly([&] { deletes.time([&] { deleteShow(name); }); }, &output);
+        if (!succeeded(output)) deletes.failed++;
+    }
+    addResult(table, "addShow", shows, move(adds));
+    addResult(table, "editShow", shows, move(edits));
+    addResult(table, "deleteShow", shows, move(deletes));
+}
+
+static void benchReports(Table& table, size_t shows, const BenchOptions& options) {
+    static const char* const queries[] = {
+        "shows where day = Luni order by duration desc limit 50",
+        "shows where category = Film and start >= 20:00",
+        "shows where duration = 30",
+        "shows group by channel order by count desc limit 20",
+        "shows group by country",
+    };
+    // A prefix, a word, a substring and typos
+    static const char* const searches[] = {"fotbal", "de seara", "tiri", "fotbl", "interviuu 12"};
+    Samples summary, day, longest, shortest, average, query, search;
+    summary.rowsPerCall = shows;
+    day.rowsPerCall = max<size_t>(1, shows / daysPerWeek);
+    quietly([&] {
+        for (size_t run = 0; run < options.runs; ++run) {
+            summary.time([] { broadcastSummary(); });
+            for (int d = 0; d < daysPerWeek; ++d) {
+                const string& name = dayName(static_cast<Day>(d));
+                day.time([&] { specificDayShow(name); });
+            }
+            longest.time([] { maxShow(); });
+            shortest.time([] { minShow(); });
+            for (const char* category : {"Stiri", "Film", "Sport", "Talent show"}) {
+                average.time([&] { averageShow(category); });
+            }
+            for (const char* text : queries) {
+                query.time([&] { runQueryText(text, false); });
+            }
+            for (const char* text : searches) {
+                search.time([&] { searchCatalog(text); });
+            }
+        }
+    });
+    addResult(table, "broadcastSummary", shows, move(summary));
+    addResult(table, "specificDayShow", shows, move(day));
+    addResult(table, "maxShow", shows, move(longest));
+    addResult(table, "minShow", shows, move(shortest));
+    addResult(table, "averageShow", shows, move(average));
+    addResult(table, "query", shows, move(query));
+    addResult(table, "search", shows, move(search));
+}
+
+static bool benchSize(Table& table, size_t shows, const BenchOptions& options) {
+    string dir = (filesystem::path(options.dir) / ("shows-" + to_string(shows))).string();
+    GeneratorOptions generator;
+    generator.shows = shows;
+    generator.seed = options.seed;
+    string error;
+    Samples generated;
+    generated.rowsPerCall = shows;
+    bool ok = true;
+    generated.time([&] { ok = generateCatalog(dir, generator, error); });
+    if (!ok) {
+        cerr << "Error: " << error << endl;
+        return false;
+    }
+    addResult(table, "generate", shows, move(generated));
+
+    // The journal is relative to the working directory and must start empty
+    error_code ec;
+    filesystem::path home = filesystem::current_path();
+    filesystem::current_path(dir, ec);
+    if (ec) {
+        cerr << "Error: cannot enter " << dir << ": " << ec.message() << endl;
+        return false;
+    }
+    filesystem::remove("Catalog.journal", ec);
+
+    benchLoad(table, shows, options);
+    benchEdits(table, shows, options);
+    benchReports(table, shows, options);
+
+    // Folds the edits back in, which also lets go of this directory's journal
+    quietly([] { journal.compact(catalog); });
+    catalog = Catalog();
+    filesystem::current_path(home, ec);
+    return true;
+}
+
+// Accepts 1000, 10k, 1M and the like
+static bool parseSize(const string& text, size_t& size) {
+    char* end = nullptr;
+    double value = strtod(text.c_str(), &end);
+    if (end == text.c_str() || value <= 0) return false;
+    if (*end == 'k' || *end == 'K') {
+        value *= 1e3;
+        ++end;
+    } else if (*end == 'm' || *end == 'M') {
+        value *= 1e6;
+        ++end;
+    }
+    if (*end != '\0') return false;
+    size = static_cast<size_t>(value);
+    return true;
+}
+
+static bool parseSizes(const string& text, vector<size_t>& sizes) {
+    sizes.clear();
+    stringstream list(text);
+    string item;
+    while (getline(list, item, ',')) {
+        size_t size;
+        if (!parseSize(item, size)) return false;
+        sizes.push_back(size);
+    }
+    sort(sizes.begin(), sizes.end());
+    return !sizes.empty();
+}
+
+static int usage() {
+    cerr << "Usage: PracticaBench [--shows N[,N...]] [--runs N] [--ops N] [--seed N] [--dir DIR]"
+            " [--format json|csv|text] [--arena on|off]\n"
+            "       PracticaBench generate SHOWS [DIR [SEED]]" << endl;
+    return 2;
+}
+
+int main(int argc, char* argv[]) {
+    vector<string> args(argv + 1, argv + argc);
+
+    if (!args.empty() && args[0] == "generate") {
+        GeneratorOptions generator;
+        if (args.size() < 2 || args.size() > 4 || !parseSize(args[1], generator.shows)) return usage();
+        string dir = args.size() > 2 ? args[2] : ".";
+        if (args.size() > 3) generator.seed = strtoull(args[3].c_str(), nullptr, 10);
+        string error;
+        if (!generateCatalog(dir, generator, error)) {
+            cerr << "Error: " << error << endl;
+            return 1;
+        }
+        cout << "Generated " << generator.shows << " shows on " << generatedChannelCount(generator)
+             << " channels in " << dir << endl;
+        return 0;
+    }
+
+    BenchOptions options;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const string& flag = args[i];
+        if (i + 1 == args.size()) return usage();
+        const string& value = args[++i];
+        bool valid = true;
+        if (flag == "--shows") {
+            valid = parseSizes(value, options.sizes);
+        } else if (flag == "--runs") {
+            valid = parseSize(value, options.runs);
+        } else if (flag == "--ops") {
+            valid = parseSize(value, options.ops);
+        } else if (flag == "--seed") {
+            options.seed = strtoull(value.c_str(), nullptr, 10);
+        } else if (flag == "--dir") {
+            options.dir = value;
+        } else if (flag == "--format") {
+            valid = parseTableFormat(value, options.format);
+        } else if (flag == "--arena") {
+            valid = value == "on" || value == "off";
+            options.arenas = value == "on";
+        } else {
+            valid = false;
+        }
+        if (!valid) return usage();
+    }
+
+    // Compacting mid-run would time a snapshot write inside whichever edit
+    // happened to cross the threshold
+    journal.setCompactionThreshold(UINTMAX_MAX);
+    setArenasEnabled(options.arenas);
+
+    Table table = resultTable();
+    for (size_t shows : options.sizes) {
+        if (!benchSize(table, shows, options)) return 1;
+    }
+    table.print(options.format);
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include "broadcast.h"
+#include <algorithm>
+#include <unordered_map>
+#include "parallel.h"
+
+static constexpr uint32_t notJoined = UINT32_MAX;
+
+BroadcastTotals summarizeBroadcasts(const Catalog& source, unsigned threads) {
+    // Build side: channel code -> dense channel slot. Codes are interned, so
+    // the hash table is a direct-indexed array over code IDs.
+    vector<const channel*> slots;
+    slots.reserve(source.channelCount());
+    vector<uint32_t> slotByCode(channelCodes.size(), notJoined);
+    for (const auto& c : source.channels()) {
+        ChannelCodeId code = channelCodes.find(c.code);
+        if (code == noString) continue;
+        slotByCode[code] = static_cast<uint32_t>(slots.size());
+        slots.push_back(&c);
+    }
+
+    // Probe side: per-thread partial stats per channel code, from the grouped
+    // column kernel over each thread's range of rows
+    const ShowColumns& columns = source.showColumns();
+    unsigned workers = workerCount(columns.size(), 1 << 16, threads);
+    vector<vector<DurationStats>> partials(workers);
+    parallelRanges(columns.size(), workers, [&](unsigned worker, size_t begin, size_t end) {
+        partials[worker].assign(slotByCode.size(), {});
+        groupedStats(columns, ColumnKey::Channel, {}, partials[worker], begin, end);
+    });
+
+    // Merge the partials of each joined code, then roll channels up into their countries
+    BroadcastTotals totals;
+    vector<BroadcastTotal> byChannel(slots.size());
+    for (size_t slot = 0; slot < slots.size(); ++slot) byChannel[slot].name = slots[slot]->name;
+    for (size_t code = 0; code < slotByCode.size(); ++code) {
+        uint32_t slot = slotByCode[code];
+        if (slot == notJoined) continue;
+        for (const auto& p : partials) {
+            byChannel[slot].shows += p[code].count;
+            byChannel[slot].minutes += p[code].sum;
+        }
+    }
+
+    unordered_map<string, size_t> countryIndex;
+    for (size_t slot = 0; slot < slots.size(); ++slot) {
+        const BroadcastTotal& c = byChannel[slot];
+        if (c.shows == 0) continue;
+        auto [it, inserted] = countryIndex.try_emplace(slots[slot]->originCountry, totals.countries.size());
+        if (inserted) totals.countries.push_back({slots[slot]->originCountry, 0, 0});
+        totals.countries[it->second].shows += c.shows;
+        totals.countries[it->second].minutes += c.minutes;
+        totals.channels.push_back(c);
+    }
+
+    auto byName = [](const BroadcastTotal& a, const BroadcastTotal& b) { return a.name < b.name; };
+    ranges::sort(totals.channels, byName);
+    ranges::sort(totals.countries, byName);
+    return totals;
+}
@@ -0,0 +1,29 @@
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "catalog.h"
+
+using namespace std;
+
+struct BroadcastTotal {
+    string name;            // encoded channel name or country
+    uint32_t shows = 0;
+    int64_t minutes = 0;
+};
+
+// Per-channel and per-country totals, each sorted by name
+struct BroadcastTotals {
+    vector<BroadcastTotal> channels;
+    vector<BroadcastTotal> countries;
+};
+
+// Joins shows to channels through a code -> channel hash table and sums show
+// counts and minutes per channel in one pass over the show columns. Large
+// catalogs are split across threads (0 = one per core) whose partial counts
+// are merged at the end. Shows whose channel no longer exists are skipped.
+BroadcastTotals summarizeBroadcasts(const Catalog& source, unsigned threads = 0);
+
+#endif // BROADCAST_H
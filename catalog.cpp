@@ -0,0 +1,280 @@
+#include "catalog.h"
+#include <tuple>
+
+// Compact a table once its tombstones outnumber its live rows (and are worth it)
+static bool needsCompaction(size_t slots, size_t live) {
+    size_t dead = slots - live;
+    return dead > 1024 && dead > live;
+}
+
+ShowId Catalog::findShow(const string& name) const {
+    const ShowId* id = showsByName.find(name);
+    return id ? *id : noShow;
+}
+
+// The offset-th live row: direct while there are no tombstones, otherwise a
+// walk over the live flags
+static uint32_t liveRowAt(const vector<uint8_t>& live, size_t liveCount, size_t offset) {
+    if (offset >= liveCount) return UINT32_MAX;
+    if (live.size() == liveCount) return static_cast<uint32_t>(offset);
+    for (size_t id = 0; id < live.size(); ++id) {
+        if (live[id] && offset-- == 0) return static_cast<uint32_t>(id);
+    }
+    return UINT32_MAX;
+}
+
+ShowId Catalog::showAtOffset(size_t offset) const {
+    return liveRowAt(showLive, liveShows, offset);
+}
+
+ChannelId Catalog::channelAtOffset(size_t offset) const {
+    return liveRowAt(channelLive, liveChannels, offset);
+}
+
+ShowId Catalog::insertShow(show s) {
+    if (showsByName.contains(s.name)) return noShow;
+
+    auto id = static_cast<ShowId>(showSlots.size());
+    showsByName.set(s.name, id);
+    columns.set(id, s);
+    schedule.add(id, s);
+    airing.add(id, s);
+    aggregates.add(id, s);
+    lineup.add(id, s);
+    showNames.add(id, s.name);
+    showSlots.push_back(move(s));
+    showLive.push_back(1);
+    liveShows++;
+    return id;
+}
+
+bool Catalog::updateShow(ShowId id, show s) {
+    const show& current = showSlots[id];
+    if (s.name != current.name) {
+        if (showsByName.contains(s.name)) return false;
+        showsByName.erase(current.name);
+        showsByName.set(s.name, id);
+        showNames.remove(id, current.name);
+        showNames.add(id, s.name);
+    }
+    columns.set(id, s);
+    schedule.remove(id, current);
+    schedule.add(id, s);
+    airing.remove(id, current);
+    airing.add(id, s);
+    aggregates.remove(id, current);
+    aggregates.add(id, s);
+    if (s.channelCode != current.channelCode) {
+        lineup.remove(id, current);
+        lineup.add(id, s);
+    }
+    showSlots.mut(id) = move(s);
+    return true;
+}
+
+void Catalog::eraseShow(ShowId id) {
+    if (id >= showSlots.size() || !showLive[id]) return;
+    removeShow(id);
+    if (needsCompaction(showSlots.size(), liveShows)) compactShows();
+}
+
+// Drops a live show from the table and every index; compaction is up to the caller
+void Catalog::removeShow(ShowId id) {
+    showsByName.erase(showSlots[id].name);
+    columns.erase(id);
+    schedule.remove(id, showSlots[id]);
+    airing.remove(id, showSlots[id]);
+    aggregates.remove(id, showSlots[id]);
+    lineup.remove(id, showSlots[id]);
+    showNames.remove(id, showSlots[id].name);
+    showSlots.mut(id) = show{};
+    showLive[id] = 0;
+    liveShows--;
+}
+
+void Catalog::compactShows() {
+    columns.compact(showLive);
+    vector<ShowId> newIds(showSlots.size(), noShow);
+    // Chunks may be shared with other versions, so the survivors are copied
+    // into fresh ones rather than moved down in place
+    ShowSlots kept;
+    kept.reserve(liveShows);
+    for (size_t in = 0; in < showSlots.size(); ++in) {
+        if (!showLive[in]) continue;
+        auto out = static_cast<ShowId>(kept.size());
+        newIds[in] = out;
+        showsByName.set(showSlots[in].name, out);
+        kept.push_back(showSlots[in]);
+    }
+    showSlots = move(kept);
+    showLive.assign(showSlots.size(), 1);
+    schedule.remap(newIds);
+    airing.remap(newIds);
+    aggregates.remap(newIds);
+    lineup.remap(newIds);
+    showNames.remap(newIds);
+}
+
+ChannelId Catalog::findChannelByCode(const string& code) const {
+    auto it = channelsByCode.find(code);
+    return it == channelsByCode.end() ? noChannel : it->second;
+}
+
+ChannelId Catalog::findChannelByName(const string& name) const {
+    auto it = channelsByName.find(name);
+    return it == channelsByName.end() ? noChannel : it->second;
+}
+
+ChannelId Catalog::insertChannel(channel c) {
+    if (channelsByCode.contains(c.code) || channelsByName.contains(c.name)) return noChannel;
+
+    auto id = static_cast<ChannelId>(channelSlots.size());
+    indexCode(c.code, id);
+    channelsByName.emplace(c.name, id);
+    channelNames.add(id, c.name);
+    channelSlots.push_back(move(c));
+    channelLive.push_back(1);
+    liveChannels++;
+    return id;
+}
+
+bool Catalog::updateChannel(ChannelId id, channel c) {
+    channel& current = channelSlots[id];
+    if (c.code != current.code && channelsByCode.contains(c.code)) return false;
+    if (c.name != current.name && channelsByName.contains(c.name)) return false;
+    // Shows refer to their channel by code
+    if (c.code != current.code && showsOnChannel(channelCodes.find(current.code)).size() > 0) return false;
+
+    if (c.code != current.code) {
+        unindexCode(current.code);
+        indexCode(c.code, id);
+    }
+    if (c.name != current.name) {
+        channelsByName.erase(current.name);
+        channelsByName.emplace(c.name, id);
+        channelNames.remove(id, current.name);
+        channelNames.add(id, c.name);
+    }
+    current = move(c);
+    return true;
+}
+
+bool Catalog::eraseChannel(ChannelId id, ChannelErase mode) {
+    if (id >= channelSlots.size() || !channelLive[id]) return false;
+
+    channel& c = channelSlots[id];
+    const PostingList& dependents = showsOnChannel(channelCodes.find(c.code));
+    if (dependents.size() > 0) {
+        if (mode == ChannelErase::Refuse) return false;
+        // Copied first, since erasing the shows empties the list
+        vector<ShowId> doomed;
+        doomed.reserve(dependents.size());
+        for (ShowId dependent : dependents) doomed.push_back(dependent);
+        for (ShowId dependent : doomed) removeShow(dependent);
+        if (needsCompaction(showSlots.size(), liveShows)) compactShows();
+    }
+    unindexCode(c.code);
+    channelsByName.erase(c.name);
+    channelNames.remove(id, c.name);
+    c = channel{};
+    channelLive[id] = 0;
+    liveChannels--;
+
+    if (needsCompaction(channelSlots.size(), liveChannels)) compactChannels();
+    return true;
+}
+
+void Catalog::compactChannels() {
+    vector<ChannelId> newIds(channelSlots.size(), noChannel);
+    size_t out = 0;
+    for (size_t in = 0; in < channelSlots.size(); ++in) {
+        if (!channelLive[in]) continue;
+        newIds[in] = static_cast<ChannelId>(out);
+        if (out != in) channelSlots[out] = move(channelSlots[in]);
+        channelsByCode[channelSlots[out].code] = static_cast<ChannelId>(out);
+        channelsByName[channelSlots[out].name] = static_cast<ChannelId>(out);
+        channelsByCodeId[channelCodes.intern(channelSlots[out].code)] = static_cast<ChannelId>(out);
+        out++;
+    }
+    channelSlots.resize(out);
+    channelLive.assign(out, 1);
+    channelNames.remap(newIds);
+}
+
+void Catalog::indexCode(const string& code, ChannelId id) {
+    channelsByCode.emplace(code, id);
+    ChannelCodeId codeId = channelCodes.intern(code);
+    if (codeId >= channelsByCodeId.size()) channelsByCodeId.resize(codeId + 1, noChannel);
+    channelsByCodeId[codeId] = id;
+    indexNumericCode(code);
+}
+
+void Catalog::unindexCode(const string& code) {
+    channelsByCode.erase(code);
+    ChannelCodeId codeId = channelCodes.find(code);
+    if (codeId < channelsByCodeId.size()) channelsByCodeId[codeId] = noChannel;
+    unindexNumericCode(code);
+}
+
+// Codes that don't start with a number are skipped by ID generation
+static bool parseNumericCode(const string& code, int& value) {
+    try {
+        value = stoi(code);
+        return true;
+    } catch (const exception&) {
+        return false;
+    }
+}
+
+void Catalog::indexNumericCode(const string& code) {
+    int value;
+    if (parseNumericCode(code, value)) numericCodes.insert(value);
+}
+
+void Catalog::unindexNumericCode(const string& code) {
+    int value;
+    if (!parseNumericCode(code, value)) return;
+    auto it = numericCodes.find(value);
+    if (it != numericCodes.end()) numericCodes.erase(it);
+}
+
+void Catalog::search(string_view text, size_t limit, vector<SearchMatch>& out) const {
+    out.clear();
+    string query = normalizeSearch(text);
+    if (query.empty() || limit == 0) return;
+
+    // There are few categories, so they are matched directly; those no show
+    // uses any more are skipped
+    for (CategoryId id = 0; id < categoryNames.size(); ++id) {
+        MatchKind kind;
+        int typos;
+        if (aggregates.category(id).count > 0 && matchName(query, categoryNames.str(id), kind, typos)) {
+            out.push_back({SearchTarget::Category, id, kind, static_cast<uint8_t>(typos)});
+        }
+    }
+    vector<NameIndex::Match> found;
+    channelNames.search(query, limit, [&](uint32_t id) -> string_view { return channelSlots[id].name; }, found);
+    for (const auto& m : found) out.push_back({SearchTarget::Channel, m.id, m.kind, m.typos});
+    found.clear();
+    showNames.search(query, limit, [&](uint32_t id) -> string_view { return showSlots[id].name; }, found);
+    for (const auto& m : found) out.push_back({SearchTarget::Show, m.id, m.kind, m.typos});
+
+    // Each source found its best matches, so the best of all are among them
+    ranges::stable_sort(out, {}, [](const SearchMatch& m) { return tuple(m.kind, m.typos, m.target); });
+    if (out.size() > limit) out.resize(limit);
+}
+
+void Catalog::reserve(size_t shows, size_t channelsHint) {
+    showSlots.reserve(shows);
+    showLive.reserve(shows);
+    showsByName.reserve(shows);
+    columns.reserve(shows);
+    channelSlots.reserve(channelsHint);
+    channelLive.reserve(channelsHint);
+    channelsByCode.reserve(channelsHint);
+    channelsByName.reserve(channelsHint);
+}
+
+void Catalog::clear() {
+    *this = Catalog{};
+}
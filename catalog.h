@@ -0,0 +1,202 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "aggregates.h"
+#include "airing.h"
+#include "columnar.h"
+#include "cow.h"
+#include "intern.h"
+#include "lineup.h"
+#include "schedule.h"
+#include "search.h"
+
+using namespace std;
+
+// Category and channel code are IDs into the shared categoryNames and
+// channelCodes dictionaries
+struct show {
+    string name;
+    CategoryId category;
+    ChannelCodeId channelCode;
+    int duration;        // in minutes
+    uint8_t startHour;
+    uint8_t startMinute;
+    Day dayOfWeek;
+};
+
+struct channel {
+    string code;
+    string name;
+    string originCountry;
+};
+
+// Stable handles into the catalog tables. They stay valid until the record is
+// erased; a compaction (triggered by erases) may renumber the remaining ones.
+using ShowId = uint32_t;
+using ChannelId = uint32_t;
+constexpr ShowId noShow = UINT32_MAX;
+constexpr ChannelId noChannel = UINT32_MAX;
+
+// What erasing a channel does about the shows still on it
+enum class ChannelErase : uint8_t {
+    Refuse,     // leaves the channel in place
+    Cascade     // erases the shows with it
+};
+
+// What a search result names
+enum class SearchTarget : uint8_t {
+    Category,
+    Channel,
+    Show
+};
+
+struct SearchMatch {
+    SearchTarget target;
+    uint32_t id;        // CategoryId, ChannelId or ShowId
+    MatchKind kind;
+    uint8_t typos;
+};
+
+// Iterates the live rows of a tombstoned table in insertion order
+template <typename T, typename Slots = vector<T>>
+class LiveRows {
+public:
+    class iterator {
+    public:
+        iterator(const Slots* slots, const vector<uint8_t>* live, uint32_t pos)
+            : slots(slots), live(live), pos(pos) { skipDead(); }
+        const T& operator*() const { return (*slots)[pos]; }
+        const T* operator->() const { return &(*slots)[pos]; }
+        uint32_t id() const { return pos; }
+        iterator& operator++() { ++pos; skipDead(); return *this; }
+        bool operator==(const iterator& other) const { return pos == other.pos; }
+
+    private:
+        void skipDead() {
+            while (pos < slots->size() && !(*live)[pos]) ++pos;
+        }
+
+        const Slots* slots;
+        const vector<uint8_t>* live;
+        uint32_t pos;
+    };
+
+    LiveRows(const Slots& slots, const vector<uint8_t>& live) : slots(&slots), live(&live) {}
+    iterator begin() const { return iterator(slots, live, 0); }
+    iterator end() const { return iterator(slots, live, static_cast<uint32_t>(slots->size())); }
+    iterator from(uint32_t id) const {       // first live row at or after id
+        return iterator(slots, live, min(id, static_cast<uint32_t>(slots->size())));
+    }
+
+private:
+    const Slots* slots;
+    const vector<uint8_t>* live;
+};
+
+// Show records are kept in copy-on-write chunks
+using ShowSlots = ChunkedVector<show>;
+using ShowRows = LiveRows<show, ShowSlots>;
+
+// Owns the show and channel tables and keeps hash indexes by show name,
+// channel code and channel name in sync with every insert, update and erase.
+// Shows are also listed by channel, which keeps channels from being erased
+// or recoded out from under their shows.
+// Erased rows are tombstoned so ids stay stable and iteration keeps the
+// original insertion order; tombstones are compacted away once they outnumber
+// the live rows.
+//
+// Show and channel names are also indexed by trigram (see search.h) for
+// prefix, substring and typo-tolerant search.
+//
+// Copying a catalog is cheap: the show records, the name indexes and the
+// schedule, airing and duration indexes are copy-on-write (see cow.h), so a
+// copy shares them with the original until one side changes a part. Only the
+// flat show columns and the channel table are copied outright.
+class Catalog {
+public:
+    // Shows
+    size_t showCount() const { return liveShows; }
+    bool hasShow(const string& name) const { return showsByName.contains(name); }
+    ShowId findShow(const string& name) const;
+    const show& getShow(ShowId id) const { return showSlots[id]; }
+    ShowId insertShow(show s);                  // noShow if the name is taken
+    bool updateShow(ShowId id, show s);         // false if the new name is taken
+    void eraseShow(ShowId id);
+
+    ShowRows shows() const { return {showSlots, showLive}; }
+    ShowId showAtOffset(size_t offset) const;   // noShow past the end
+    const ShowColumns& showColumns() const { return columns; }
+    DaySchedule::Range showsOn(Day day) const { return schedule.on(day); }     // by start time
+    void showsAiringAt(uint32_t at, vector<ShowId>& out, optional<ChannelCodeId> channel = nullopt) const {
+        airing.airingAt(at, out, channel);
+    }
+    void showsAiringDuring(uint32_t from, uint32_t length, vector<ShowId>& out,
+                           optional<ChannelCodeId> channel = nullopt) const {
+        airing.airingDuring(from, length, out, channel);
+    }
+    const DurationAggregates& durations() const { return aggregates; }    // running min/max/sum/count
+    const PostingList& showsOnChannel(ChannelCodeId code) const { return lineup.of(code); }   // in id order
+
+    // Channels
+    size_t channelCount() const { return liveChannels; }
+    bool hasChannelCode(const string& code) const { return channelsByCode.contains(code); }
+    bool hasChannelName(const string& name) const { return channelsByName.contains(name); }
+    ChannelId findChannelByCode(const string& code) const;
+    ChannelId findChannelByName(const string& name) const;
+    ChannelId findChannelByCodeId(ChannelCodeId code) const {
+        return code < channelsByCodeId.size() ? channelsByCodeId[code] : noChannel;
+    }
+    const channel& getChannel(ChannelId id) const { return channelSlots[id]; }
+    ChannelId insertChannel(channel c);         // noChannel if code or name is taken
+    bool updateChannel(ChannelId id, channel c);        // false if taken, or a recode while shows use the code
+    bool eraseChannel(ChannelId id, ChannelErase mode = ChannelErase::Refuse);    // false if refused
+    int maxNumericChannelCode() const { return numericCodes.empty() ? 0 : max(0, *numericCodes.rbegin()); }
+
+    LiveRows<channel> channels() const { return {channelSlots, channelLive}; }
+    ChannelId channelAtOffset(size_t offset) const;
+
+    // Up to limit categories, channels and shows whose names match the text,
+    // best matches first: by match kind, then fewer typos, then categories
+    // before channels before shows
+    void search(string_view text, size_t limit, vector<SearchMatch>& out) const;
+
+    void reserve(size_t shows, size_t channelsHint);
+    void clear();
+
+private:
+    void removeShow(ShowId id);
+    void compactShows();
+    void compactChannels();
+    void indexCode(const string& code, ChannelId id);
+    void unindexCode(const string& code);
+    void indexNumericCode(const string& code);
+    void unindexNumericCode(const string& code);
+
+    ShowSlots showSlots;
+    vector<uint8_t> showLive;
+    size_t liveShows = 0;
+    ShardedMap<ShowId> showsByName;
+    ShowColumns columns;
+    DaySchedule schedule;
+    AiringIndex airing;
+    DurationAggregates aggregates;
+    ChannelLineup lineup;
+    NameIndex showNames;
+
+    vector<channel> channelSlots;
+    vector<uint8_t> channelLive;
+    size_t liveChannels = 0;
+    unordered_map<string, ChannelId> channelsByCode;
+    unordered_map<string, ChannelId> channelsByName;
+    NameIndex channelNames;
+    vector<ChannelId> channelsByCodeId;    // indexed by interned channel code
+    multiset<int> numericCodes;     // numeric channel codes, for ID generation
+};
+
+#endif // CATALOG_H
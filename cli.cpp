@@ -0,0 +1,269 @@
+#include "cli.h"
+#include <fstream>
+#include <iostream>
+#include "journal.h"
+#include "server.h"
+#include "tvmodule.h"
+
+// Set by --format; applies to the listing commands
+static TableFormat outputFormat = TableFormat::Text;
+
+struct Command {
+    const char* name;
+    size_t minArgs;
+    size_t maxArgs;
+    const char* usage;
+    int (*run)(const vector<string>& args);      // returns the exit status
+};
+
+static int status(bool succeeded) {
+    return succeeded ? 0 : 1;
+}
+
+static int toInt(const string& text, int fallback) {
+    try {
+        return stoi(text);
+    } catch (const exception&) {
+        return fallback;
+    }
+}
+
+// "-" keeps the current value of a field in edit commands
+static string keepOr(const string& arg, const string& current) {
+    return arg == "-" ? current : arg;
+}
+
+// Names are stored with '_' in place of spaces
+static string stored(string s) {
+    for (char& c : s) {
+        if (c == ' ') c = '_';
+    }
+    return s;
+}
+
+// Fills in the kept fields so editShow/editChannel have nothing to prompt for
+static int editShowCommand(const vector<string>& a) {
+    ShowId id = catalog.findShow(stored(a[0]));
+    if (id == noShow) {
+        cout << "Show not found." << endl;
+        return 1;
+    }
+    const show& s = catalog.getShow(id);
+    int duration = a[4] == "-" ? s.duration : toInt(a[4], 0);
+    if (duration <= 0) {
+        cout << "Invalid duration." << endl;
+        return 1;
+    }
+    return status(editShow(a[0], keepOr(a[1], s.name), keepOr(a[2], categoryNames.str(s.category)),
+                           keepOr(a[3], formatStartTime(s.startHour, s.startMinute)), duration,
+                           keepOr(a[5], dayName(s.dayOfWeek)), keepOr(a[6], channelCodes.str(s.channelCode))));
+}
+
+static int editChannelCommand(const vector<string>& a) {
+    ChannelId id = catalog.findChannelByName(stored(a[0]));
+    if (id == noChannel) {
+        cout << "Channel not found." << endl;
+        return 1;
+    }
+    const channel& c = catalog.getChannel(id);
+    return status(editChannel(a[0], keepOr(a[1], c.name), keepOr(a[2], c.originCountry)));
+}
+
+// Queries and server requests may come as one argument or as one word per
+// argument; in the latter case words that contained spaces are quoted again,
+// unless they carry quotes of their own and so are fragments of the request
+static string joinArgs(const vector<string>& args) {
+    if (args.size() == 1) return args[0];
+    string text;
+    for (const auto& a : args) {
+        if (!text.empty()) text += ' ';
+        bool quote = a.find(' ') != string::npos && a.find('"') == string::npos;
+        text += quote ? '"' + a + '"' : a;
+    }
+    return text;
+}
+
+static const Command commands[] = {
+    {"shows", 0, 2, "shows [OFFSET [LIMIT]]",
+     [](const vector<string>& a) {
+         if (a.empty()) {
+             allShows(outputFormat);
+         } else {
+             showsPage(max(0, toInt(a[0], 0)), a.size() > 1 ? max(0, toInt(a[1], 0)) : defaultPageSize, outputFormat);
+         }
+         return 0;
+     }},
+    {"channels", 0, 2, "channels [OFFSET [LIMIT]]",
+     [](const vector<string>& a) {
+         if (a.empty()) {
+             allChannels(outputFormat);
+         } else {
+             channelsPage(max(0, toInt(a[0], 0)), a.size() > 1 ? max(0, toInt(a[1], 0)) : defaultPageSize,
+                          outputFormat);
+         }
+         return 0;
+     }},
+    {"add-show", 6, 6, "add-show NAME CATEGORY HH:MM DURATION DAY CHANNEL_CODE",
+     [](const vector<string>& a) {
+         int duration = toInt(a[3], 0);
+         if (duration <= 0) {
+             cout << "Invalid duration." << endl;
+             return 1;
+         }
+         return status(addShow(a[0], a[1], a[2], duration, a[4], a[5]));
+     }},
+    {"add-channel", 2, 2, "add-channel NAME COUNTRY", [](const vector<string>& a) { return status(addChannel(a[0], a[1])); }},
+    {"delete-show", 1, 1, "delete-show NAME", [](const vector<string>& a) { return status(deleteShow(a[0])); }},
+    {"delete-channel", 1, 2, "delete-channel NAME [cascade]  (cascade also deletes its shows)",
+     [](const vector<string>& a) {
+         if (a.size() == 2 && a[1] != "cascade") {
+             cout << "Unknown option: " << a[1] << endl;
+             return 1;
+         }
+         return status(deleteChannel(a[0], a.size() == 2));
+     }},
+    {"edit-show", 7, 7, "edit-show NAME NEW_NAME CATEGORY HH:MM DURATION DAY CHANNEL_CODE  (- keeps a field)",
+     editShowCommand},
+    {"edit-channel", 3, 3, "edit-channel NAME NEW_NAME COUNTRY  (- keeps a field)", editChannelCommand},
+    {"summary", 0, 0, "summary", [](const vector<string>&) { return status(broadcastSummary()); }},
+    {"day", 1, 1, "day DAY", [](const vector<string>& a) { return status(specificDayShow(a[0], outputFormat)); }},
+    {"channel-shows", 1, 1, "channel-shows CODE", [](const vector<string>& a) { return status(channelShows(a[0], outputFormat)); }},
+    {"longest", 0, 0, "longest", [](const vector<string>&) { maxShow(outputFormat); return 0; }},
+    {"shortest", 0, 0, "shortest", [](const vector<string>&) { minShow(outputFormat); return 0; }},
+    {"average", 1, 1, "average CATEGORY", [](const vector<string>& a) { averageShow(a[0]); return 0; }},
+    {"stats", 0, 0, "stats",
+     [](const vector<string>&) {
+         durationSummary();
+         operationStats(outputFormat);
+         return 0;
+     }},
+    {"whats-on", 2, 4, "whats-on DAY HH:MM [WINDOW_MINUTES] [CHANNEL_CODE]",
+     [](const vector<string>& a) {
+         return status(whatsOn(a[0], a[1], a.size() > 2 ? toInt(a[2], -1) : 0, a.size() > 3 ? a[3] : "",
+                               outputFormat));
+     }},
+    {"conflicts", 0, 0, "conflicts", [](const vector<string>&) { checkConflicts(); return 0; }},
+    {"query", 1, SIZE_MAX, "query \"shows [where ...] [group by ...] [order by ...] [limit N]\"",
+     [](const vector<string>& a) { return status(runQueryText(joinArgs(a), false, outputFormat)); }},
+    {"explain", 1, SIZE_MAX, "explain \"QUERY\"",
+     [](const vector<string>& a) { return status(runQueryText(joinArgs(a), true)); }},
+    {"search", 1, SIZE_MAX, "search TEXT...",
+     [](const vector<string>& a) {
+         string text;
+         for (const auto& word : a) text += (text.empty() ? "" : " ") + word;
+         searchCatalog(text, defaultSearchResults, outputFormat);
+         return 0;
+     }},
+    {"import", 1, 1, "import FILE", [](const vector<string>& a) { return status(importShows(a[0])); }},
+    {"export-snapshot", 1, 1, "export-snapshot FILE", [](const vector<string>& a) { return status(exportSnapshot(a[0])); }},
+    {"import-snapshot", 1, 1, "import-snapshot FILE", [](const vector<string>& a) { return status(importSnapshot(a[0])); }},
+    {"serve", 0, 1, "serve [SOCKET_PATH | tcp:PORT]  (default practica.sock)",
+     [](const vector<string>& a) {
+         return runServer(a.empty() ? "practica.sock" : a[0], catalog, journal);
+     }},
+    {"remote", 2, SIZE_MAX, "remote SOCKET_PATH|tcp:PORT REQUEST...",
+     [](const vector<string>& a) {
+         return runRemote(a[0], joinArgs(vector<string>(a.begin() + 1, a.end())));
+     }},
+    {"load-test", 1, 4, "load-test SOCKET_PATH|tcp:PORT [CLIENTS [SECONDS [WRITE_PERCENT]]]",
+     [](const vector<string>& a) {
+         return runLoadGenerator(a[0], a.size() > 1 ? max(1, toInt(a[1], 8)) : 8,
+                                 a.size() > 2 ? max(1, toInt(a[2], 5)) : 5,
+                                 a.size() > 3 ? clamp(toInt(a[3], 10), 0, 100) : 10);
+     }},
+};
+
+vector<string> splitCommandLine(const string& line) {
+    vector<string> words;
+    string word;
+    bool quoted = false, inWord = false;
+    for (char c : line) {
+        if (c == '"') {
+            quoted = !quoted;
+            inWord = true;
+        } else if (!quoted && (c == ' ' || c == '\t' || c == '\r')) {
+            if (inWord) words.push_back(move(word));
+            word.clear();
+            inWord = false;
+        } else {
+            word += c;
+            inWord = true;
+        }
+    }
+    if (inWord) words.push_back(move(word));
+    return words;
+}
+
+int runCommand(const vector<string>& words) {
+    if (words.empty()) return 1;
+    for (const auto& command : commands) {
+        if (words[0] != command.name) continue;
+        vector<string> args(words.begin() + 1, words.end());
+        if (args.size() < command.minArgs || args.size() > command.maxArgs) {
+            cout << "Usage: " << command.usage << endl;
+            return 1;
+        }
+        return command.run(args);
+    }
+    cout << "Unknown command: " << words[0] << endl;
+    return 1;
+}
+
+int runScript(istream& in) {
+    string line;
+    size_t number = 0;
+    while (getline(in, line)) {
+        number++;
+        vector<string> words = splitCommandLine(line);
+        if (words.empty() || words[0][0] == '#') continue;
+        if (int failed = runCommand(words)) {
+            cout << "Script stopped at line " << number << "." << endl;
+            return failed;
+        }
+    }
+    return 0;
+}
+
+void printUsage() {
+    cout << "Usage: practica [--format text|csv|json] [command [args...]]" << endl
+         << "Without a command the interactive menu starts." << endl << endl
+         << "Commands:" << endl;
+    for (const auto& command : commands) {
+        cout << "  " << command.usage << endl;
+    }
+    cout << "  script [FILE]  (one command per line; stdin when FILE is - or missing)" << endl;
+}
+
+int runCli(int argc, char* argv[]) {
+    vector<string> words(argv + 1, argv + argc);
+    if (words[0] == "--format" || words[0].starts_with("--format=")) {
+        string value = words[0].size() > 8 ? words[0].substr(9) : (words.size() > 1 ? words[1] : "");
+        words.erase(words.begin(), words.begin() + (words[0].size() > 8 ? 1 : min<size_t>(2, words.size())));
+        if (!parseTableFormat(value, outputFormat)) {
+            cout << "Unknown format: " << value << " (use text, csv or json)" << endl;
+            return 1;
+        }
+        if (words.empty()) {
+            printUsage();
+            return 1;
+        }
+    }
+    if (words[0] == "help" || words[0] == "--help" || words[0] == "-h") {
+        printUsage();
+        return 0;
+    }
+    if (words[0] == "script") {
+        if (words.size() > 2) {
+            cout << "Usage: script [FILE]" << endl;
+            return 1;
+        }
+        if (words.size() == 1 || words[1] == "-") return runScript(cin);
+        ifstream in(words[1]);
+        if (!in) {
+            cout << "Error: could not open " << words[1] << "." << endl;
+            return 1;
+        }
+        return runScript(in);
+    }
+    return runCommand(words);
+}
@@ -0,0 +1,35 @@
+#ifndef CLI_H
+#define CLI_H
+
+#include <istream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Non-interactive front end. Commands mirror the menu entries but never
+// prompt and never clear the screen, so they can be driven by scripts:
+//
+//   practica day Luni
+//   practica add-show "Stiri noi" Stiri 07:00 30 Marti 1
+//   practica script commands.txt      (one command per line, - for stdin)
+//   practica --format csv shows       (listings as text, csv or json)
+
+// Splits a command line into words; double quotes group words with spaces
+vector<string> splitCommandLine(const string& line);
+
+// Runs one command, e.g. {"day", "Luni"}, and returns its exit status: 0 on
+// success, non-zero for an unknown command, a wrong number of arguments or a
+// command that failed.
+int runCommand(const vector<string>& words);
+
+// Runs one command per line; blank lines and lines starting with # are
+// skipped. Stops at the first command that fails and returns its status.
+int runScript(istream& in);
+
+// Entry point for `practica <command> [args...]`; returns the exit status
+int runCli(int argc, char* argv[]);
+
+void printUsage();
+
+#endif // CLI_H
@@ -0,0 +1,68 @@
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+#include "intern.h"
+
+using namespace std;
+
+struct show;
+
+// Struct-of-arrays mirror of the show table, indexed by ShowId. Aggregates
+// only read the columns they need instead of pulling whole show structs
+// through the cache. Erased rows keep their slot with category = deadRow.
+class ShowColumns {
+public:
+    static constexpr uint32_t deadRow = noString;
+
+    void set(uint32_t id, const show& s);
+    void erase(uint32_t id);
+    void compact(const vector<uint8_t>& live);    // mirrors Catalog's compaction
+    void reserve(size_t rows);
+
+    size_t size() const { return duration.size(); }
+    const int32_t* durations() const { return duration.data(); }
+    const uint16_t* startMinutes() const { return startMinute.data(); }
+    const uint8_t* days() const { return day.data(); }
+    const uint32_t* categories() const { return category.data(); }
+    const uint32_t* channels() const { return channel.data(); }
+
+private:
+    vector<int32_t> duration;
+    vector<uint16_t> startMinute;     // minutes after midnight
+    vector<uint8_t> day;              // Day as an integer
+    vector<uint32_t> category;        // CategoryId, or deadRow
+    vector<uint32_t> channel;         // ChannelCodeId
+};
+
+// Rows an aggregate looks at; a field left empty matches everything
+struct ColumnFilter {
+    optional<uint32_t> category;
+    optional<uint32_t> channel;
+    optional<uint8_t> day;              // Day as an integer
+};
+
+struct DurationStats {
+    int64_t sum = 0;
+    uint32_t count = 0;
+    int32_t min = INT32_MAX;
+    int32_t max = INT32_MIN;
+
+    double average() const { return count ? static_cast<double>(sum) / count : 0.0; }
+    void add(int32_t duration);
+    void merge(const DurationStats& other);
+};
+
+// The column grouped aggregates split rows by
+enum class ColumnKey : uint8_t { Day, Category, Channel };
+
+// Adds the durations of the matching rows in [begin, end) into groups, indexed
+// by the value of the key column, in one pass; rows whose key is past the end
+// of groups are skipped
+void groupedStats(const ShowColumns& columns, ColumnKey key, const ColumnFilter& filter,
+                  span<DurationStats> groups, size_t begin = 0, size_t end = SIZE_MAX);
+
+#endif // COLUMNAR_H
@@ -0,0 +1,55 @@
+#include "conflicts.h"
+#include <algorithm>
+#include "parallel.h"
+
+vector<ShowId> conflictingShows(const Catalog& source, const show& s, ShowId ignore) {
+    vector<ShowId> found;
+    if (s.duration <= 0) return found;
+    uint32_t start = minuteOfWeek(s.dayOfWeek, s.startHour, s.startMinute);
+    source.showsAiringDuring(start, static_cast<uint32_t>(s.duration), found, s.channelCode);
+    erase(found, ignore);
+    ranges::sort(found);
+    return found;
+}
+
+struct Broadcast {
+    uint32_t start;
+    uint32_t end;
+    ShowId show;
+};
+
+// Appends every overlapping pair among one channel's broadcasts
+static void sweepChannel(vector<Broadcast>& broadcasts, vector<ScheduleConflict>& out) {
+    ranges::sort(broadcasts, [](const Broadcast& a, const Broadcast& b) { return a.start < b.start; });
+    for (size_t i = 0; i < broadcasts.size(); ++i) {
+        for (size_t j = i + 1; j < broadcasts.size() && broadcasts[j].start < broadcasts[i].end; ++j) {
+            ShowId a = broadcasts[i].show, b = broadcasts[j].show;
+            if (a != b) out.push_back({min(a, b), max(a, b)});
+        }
+    }
+}
+
+vector<ScheduleConflict> findScheduleConflicts(const Catalog& source, unsigned threads) {
+    // Bucket the live shows by channel code
+    vector<vector<Broadcast>> byChannel(channelCodes.size());
+    ShowRows shows = source.shows();
+    for (auto it = shows.begin(); it != shows.end(); ++it) {
+        AirInterval pieces[2];
+        int count = airIntervals(*it, pieces);
+        for (int p = 0; p < count; ++p) byChannel[it->channelCode].push_back({pieces[p].start, pieces[p].end, it.id()});
+    }
+    erase_if(byChannel, [](const vector<Broadcast>& b) { return b.size() < 2; });
+
+    unsigned workers = workerCount(byChannel.size(), 8, threads);
+    vector<vector<ScheduleConflict>> partials(workers);
+    parallelRanges(byChannel.size(), workers, [&](unsigned worker, size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) sweepChannel(byChannel[c], partials[worker]);
+    });
+
+    vector<ScheduleConflict> conflicts;
+    for (auto& p : partials) conflicts.insert(conflicts.end(), p.begin(), p.end());
+    // A broadcast wrapping past Sunday midnight can overlap the same show twice
+    ranges::sort(conflicts);
+    conflicts.erase(unique(conflicts.begin(), conflicts.end()), conflicts.end());
+    return conflicts;
+}
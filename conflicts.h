@@ -0,0 +1,27 @@
+#ifndef CONFLICTS_H
+#define CONFLICTS_H
+
+#include <vector>
+#include "catalog.h"
+
+using namespace std;
+
+// Two shows on the same channel whose airtime overlaps; first < second
+struct ScheduleConflict {
+    ShowId first;
+    ShowId second;
+
+    auto operator<=>(const ScheduleConflict&) const = default;
+};
+
+// Shows on s's channel that would be on the air at the same time as s,
+// leaving out `ignore` (the show being edited). Uses the catalog's interval
+// index, so only the time buckets s covers are searched.
+vector<ShowId> conflictingShows(const Catalog& source, const show& s, ShowId ignore = noShow);
+
+// Every overlapping pair in the catalog, sorted. Each channel's broadcasts
+// are sorted by start and swept once; channels are split across threads
+// (0 = one per core).
+vector<ScheduleConflict> findScheduleConflicts(const Catalog& source, unsigned threads = 0);
+
+#endif // CONFLICTS_H
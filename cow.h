@@ -0,0 +1,125 @@
+#ifndef COW_H
+#define COW_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "arena.h"
+
+using namespace std;
+
+// Copy-on-write building blocks for the catalog. Copying one of these copies
+// only shared pointers, so a new catalog version shares every part of the old
+// one it has not changed. The first write to a shared part clones just that
+// part. A part with a single owner is written in place, so a catalog that is
+// never copied pays nothing beyond one pointer hop.
+
+// A mutable *p, cloned first if another owner shares it. Only the owner
+// doing the writing can hold a use count of 1, so seeing 1 means no reader
+// can be looking at *p.
+template <typename T>
+T& unshare(shared_ptr<T>& p) {
+    if (!p) {
+        p = make_shared<T>();
+    } else if (p.use_count() != 1) {
+        p = make_shared<T>(*p);
+    }
+    return *p;
+}
+
+// A vector kept in chunks of 2^ChunkBits elements
+template <typename T, unsigned ChunkBits = 10>
+class ChunkedVector {
+public:
+    static constexpr size_t chunkSize = size_t(1) << ChunkBits;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T& operator[](size_t i) const { return (*chunks[i >> ChunkBits])[i & (chunkSize - 1)]; }
+    T& mut(size_t i) { return unshare(chunks[i >> ChunkBits])[i & (chunkSize - 1)]; }
+
+    void push_back(T value) {
+        if ((count & (chunkSize - 1)) == 0) {
+            chunks.push_back(make_shared<vector<T>>());
+            chunks.back()->reserve(chunkSize);
+        }
+        unshare(chunks.back()).push_back(move(value));
+        count++;
+    }
+    void reserve(size_t n) { chunks.reserve((n + chunkSize - 1) >> ChunkBits); }
+    void clear() {
+        chunks.clear();
+        count = 0;
+    }
+
+private:
+    vector<shared_ptr<vector<T>>> chunks;
+    size_t count = 0;
+};
+
+// A string-keyed hash map split into shards by hash. Each shard keeps its
+// keys and nodes in an arena of its own. Cloning a shard, or rebuilding it
+// once erased entries outnumber the live ones, packs it into a fresh arena.
+template <typename V>
+class ShardedMap {
+public:
+    static constexpr size_t shardCount = 256;
+
+    ShardedMap() : shards(shardCount) {}
+
+    const V* find(string_view key) const {
+        const auto& shard = shards[shardOf(key)];
+        if (!shard) return nullptr;
+        auto it = shard->entries.find(key);
+        return it == shard->entries.end() ? nullptr : &it->second;
+    }
+    bool contains(string_view key) const { return find(key) != nullptr; }
+    size_t size() const { return count; }
+
+    void set(string_view key, V value) {
+        Shard& shard = unshare(shards[shardOf(key)]);
+        auto it = shard.entries.find(key);
+        if (it != shard.entries.end()) {
+            it->second = move(value);
+            return;
+        }
+        shard.entries.emplace(shard.arena.copy(key), move(value));
+        count++;
+    }
+    void erase(string_view key) {
+        auto& slot = shards[shardOf(key)];
+        if (!slot || !slot->entries.contains(key)) return;
+        Shard& shard = unshare(slot);
+        shard.entries.erase(key);
+        count--;
+        if (++shard.erased > shard.entries.size() + 64) slot = make_shared<Shard>(as_const(shard));
+    }
+    void reserve(size_t n) {
+        for (auto& shard : shards) unshare(shard).entries.reserve(n / shardCount + 1);
+    }
+
+private:
+    struct Shard {
+        Shard() = default;
+        Shard(const Shard& other) {
+            entries.reserve(other.entries.size());
+            for (const auto& [key, value] : other.entries) entries.emplace(arena.copy(key), value);
+        }
+
+        Arena arena {1024, 64 << 10};
+        pmr::unordered_map<string_view, V> entries {&arena};     // keys point into arena
+        size_t erased = 0;
+    };
+
+    static size_t shardOf(string_view key) { return (hash<string_view>{}(key) >> 24) % shardCount; }
+
+    vector<shared_ptr<Shard>> shards;
+    size_t count = 0;
+};
+
+#endif // COW_H
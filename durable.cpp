@@ -0,0 +1,130 @@
+#include "durable.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <fcntl.h>
+#include "metrics.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Large writes go out in blocks of this size
+constexpr size_t writeBlock = 1 << 20;
+
+static bool writeAll(int fd, string_view data) {
+    while (!data.empty()) {
+        size_t chunk = min(data.size(), writeBlock);
+#ifdef _WIN32
+        int written = ::_write(fd, data.data(), static_cast<unsigned>(chunk));
+#else
+        ssize_t written = ::write(fd, data.data(), chunk);
+#endif
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+    return true;
+}
+
+static bool syncFd(int fd) {
+#ifdef _WIN32
+    return ::_commit(fd) == 0;
+#elif defined(__APPLE__)
+    return ::fcntl(fd, F_FULLFSYNC) == 0 || ::fsync(fd) == 0;
+#else
+    return ::fdatasync(fd) == 0;
+#endif
+}
+
+static int openFile(const string& path, int flags) {
+#ifdef _WIN32
+    return ::_open(path.c_str(), flags | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    return ::open(path.c_str(), flags | O_CLOEXEC, 0644);
+#endif
+}
+
+static void closeFd(int fd) {
+#ifdef _WIN32
+    ::_close(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+// Makes a rename in the directory durable (not needed, or possible, on Windows)
+static void syncDirectoryOf(const string& path) {
+#ifndef _WIN32
+    string dir = filesystem::path(path).parent_path().string();
+    int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return;
+    ::fsync(fd);
+    ::close(fd);
+#else
+    (void)path;
+#endif
+}
+
+bool writeFileAtomically(const string& path, string_view content) {
+    OpTimer timer(Op::FileWrite);
+    timer.io(content.size());
+    string tmpPath = path + ".tmp";
+    int fd = openFile(tmpPath, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd < 0) return false;
+    bool ok = writeAll(fd, content) && syncFd(fd);
+    closeFd(fd);
+    if (!ok) {
+        remove(tmpPath.c_str());
+        return false;
+    }
+
+    error_code ec;
+    filesystem::rename(tmpPath, path, ec);
+    if (ec) return false;
+    syncDirectoryOf(path);
+    return true;
+}
+
+bool AppendFile::open() {
+    if (fd >= 0) return true;
+    fd = openFile(path, O_WRONLY | O_CREAT | O_APPEND);
+    return fd >= 0;
+}
+
+bool AppendFile::append(string_view data) {
+    return open() && writeAll(fd, data);
+}
+
+bool AppendFile::sync() {
+    return fd < 0 || syncFd(fd);
+}
+
+bool AppendFile::truncate() {
+    close();
+    int truncated = openFile(path, O_WRONLY | O_CREAT | O_TRUNC);
+    if (truncated < 0) return false;
+    bool ok = syncFd(truncated);
+    closeFd(truncated);
+    return ok;
+}
+
+bool AppendFile::cut(uintmax_t length) {
+    if (fd < 0) return true;
+#ifdef _WIN32
+    return ::_chsize_s(fd, static_cast<__int64>(length)) == 0;
+#else
+    return ::ftruncate(fd, static_cast<off_t>(length)) == 0;
+#endif
+}
+
+void AppendFile::close() {
+    if (fd < 0) return;
+    closeFd(fd);
+    fd = -1;
+}
@@ -0,0 +1,37 @@
+#ifndef DURABLE_H
+#define DURABLE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// Writes content to path.tmp in large blocks, fsyncs it, renames it over path
+// and fsyncs the directory, so after a crash path holds either the complete
+// old file or the complete new one
+bool writeFileAtomically(const string& path, string_view content);
+
+// An append-only file written with plain write() calls and made durable with
+// an explicit sync(). Opened lazily on the first append.
+class AppendFile {
+public:
+    explicit AppendFile(string path) : path(move(path)) {}
+    ~AppendFile() { close(); }
+    AppendFile(const AppendFile&) = delete;
+    AppendFile& operator=(const AppendFile&) = delete;
+
+    bool append(string_view data);      // reaches the OS, not necessarily the disk
+    bool sync();                        // everything appended so far is on disk
+    bool truncate();                    // empties the file durably
+    bool cut(uintmax_t length);         // drops everything past length
+    void close();
+
+private:
+    bool open();
+
+    string path;
+    int fd = -1;
+};
+
+#endif // DURABLE_H
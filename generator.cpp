@@ -0,0 +1,189 @@
+#include "generator.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+// Small self-contained generator (splitmix64); the standard distributions are
+// not specified exactly, so they could differ between libraries
+class SeededRandom {
+public:
+    explicit SeededRandom(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+    double unit() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }      // [0, 1)
+    size_t below(size_t n) { return static_cast<size_t>(unit() * static_cast<double>(n)); }
+
+private:
+    uint64_t state;
+};
+
+// Picks an index with probability proportional to its weight
+class WeightedChoice {
+public:
+    explicit WeightedChoice(const vector<double>& weights) : cumulative(weights.size()) {
+        double total = 0;
+        for (size_t i = 0; i < weights.size(); ++i) cumulative[i] = total += weights[i];
+    }
+
+    size_t pick(SeededRandom& random) const {
+        double x = random.unit() * cumulative.back();
+        size_t i = upper_bound(cumulative.begin(), cumulative.end(), x) - cumulative.begin();
+        return min(i, cumulative.size() - 1);
+    }
+
+private:
+    vector<double> cumulative;
+};
+
+struct CategoryProfile {
+    const char* name;
+    double weight;
+    vector<int> durations;
+    array<const char*, 3> titles;
+};
+
+static const vector<CategoryProfile> categories = {
+    {"Stiri", 18, {15, 30, 60}, {"Stirile_zilei", "Jurnal", "Stiri_pe_scurt"}},
+    {"Film", 16, {90, 100, 110, 120, 150}, {"Film_de_seara", "Cinema", "Film_artistic"}},
+    {"Serial", 14, {30, 45, 60}, {"Serial", "Saga", "Episodul"}},
+    {"Sport", 10, {60, 90, 120}, {"Fotbal", "Magazin_sportiv", "Meci"}},
+    {"Divertisment", 8, {60, 90, 120}, {"Show", "Gala", "Seara_de_gala"}},
+    {"Documentar", 7, {30, 45, 60}, {"Natura", "Istorie", "Descoperiri"}},
+    {"Desene_animate", 6, {15, 20, 30}, {"Desene", "Aventuri", "Povesti"}},
+    {"Talk_show", 6, {60, 90}, {"Dialoguri", "In_direct", "Interviu"}},
+    {"Muzica", 5, {30, 60, 120}, {"Hituri", "Concert", "Top"}},
+    {"Comedie", 4, {30, 60}, {"Comedie", "Sitcom", "Umor"}},
+    {"Lifestyle", 3, {30, 60}, {"Casa", "Stil", "Fitness"}},
+    {"Cooking_show", 2, {30, 60}, {"Bucatarie", "Retete", "Chef"}},
+    {"Talent_show", 1, {120, 150, 180}, {"Talente", "Vocea", "Star"}},
+};
+
+static const char* const dayNames[] = {"Luni", "Marti", "Miercuri", "Joi", "Vineri", "Sambata", "Duminica"};
+static const vector<double> dayWeights = {13, 13, 13, 13, 14, 17, 17};
+static const vector<double> hourWeights = {1, 1, 1, 1, 1, 2, 4, 6, 6, 5, 4, 4, 5, 5, 4, 4, 5, 6, 8, 10, 12, 12, 9, 4};
+static const vector<double> minuteWeights = {8, 1, 5, 1};        // :00, :15, :30, :45
+
+struct CountryProfile {
+    const char* name;
+    double weight;
+};
+
+static const vector<CountryProfile> countries = {
+    {"Romania", 50}, {"Statele_Unite", 15}, {"Marea_Britanie", 8}, {"Ungaria", 6}, {"Franta", 5},
+    {"Germania", 5}, {"Italia", 4}, {"Spania", 3}, {"Republica_Moldova", 3}, {"Japonia", 1},
+};
+
+static const char* const channelBrands[] = {"TV", "Canal", "Sport", "Film", "Stiri", "Kids", "Muzica", "Docu"};
+
+size_t generatedChannelCount(const GeneratorOptions& options) {
+    return options.channels ? options.channels : max<size_t>(20, options.shows / 150);
+}
+
+static void appendNumber(string& out, uint64_t value) {
+    char digits[20];
+    auto end = to_chars(digits, digits + sizeof digits, value).ptr;
+    out.append(digits, end);
+}
+
+static void appendTwoDigits(string& out, int value) {
+    out += static_cast<char>('0' + value / 10);
+    out += static_cast<char>('0' + value % 10);
+}
+
+// Writes out to file once it holds a block's worth, so huge catalogs never
+// sit in memory whole
+static bool flushBlock(ofstream& file, string& out, bool force) {
+    if (!force && out.size() < (1 << 20)) return true;
+    file.write(out.data(), static_cast<streamsize>(out.size()));
+    out.clear();
+    return static_cast<bool>(file);
+}
+
+bool generateCatalog(const string& dir, const GeneratorOptions& options, string& error) {
+    error_code ec;
+    filesystem::create_directories(dir, ec);
+    if (ec) {
+        error = "cannot create " + dir + ": " + ec.message();
+        return false;
+    }
+
+    SeededRandom random(options.seed);
+    size_t channelCount = generatedChannelCount(options);
+
+    ofstream channelFile(filesystem::path(dir) / "Channel.txt", ios::binary | ios::trunc);
+    if (!channelFile) {
+        error = "cannot write Channel.txt in " + dir;
+        return false;
+    }
+    vector<double> countryWeights;
+    for (const auto& c : countries) countryWeights.push_back(c.weight);
+    WeightedChoice countryChoice(countryWeights);
+    string out;
+    for (size_t code = 1; code <= channelCount; ++code) {
+        appendNumber(out, code);
+        out += ' ';
+        out += channelBrands[random.below(size(channelBrands))];
+        out += '_';
+        appendNumber(out, code);
+        out += ' ';
+        out += countries[countryChoice.pick(random)].name;
+        out += '\n';
+        if (!flushBlock(channelFile, out, false)) break;
+    }
+    if (!flushBlock(channelFile, out, true)) {
+        error = "cannot write Channel.txt in " + dir;
+        return false;
+    }
+
+    // Channel popularity follows Zipf's law: channel k carries about 1/k as
+    // many shows as channel 1
+    vector<double> channelWeights(channelCount);
+    for (size_t k = 0; k < channelCount; ++k) channelWeights[k] = 1.0 / static_cast<double>(k + 1);
+    WeightedChoice channelChoice(channelWeights);
+    vector<double> categoryWeights;
+    for (const auto& c : categories) categoryWeights.push_back(c.weight);
+    WeightedChoice categoryChoice(categoryWeights);
+    WeightedChoice dayChoice(dayWeights);
+    WeightedChoice hourChoice(hourWeights);
+    WeightedChoice minuteChoice(minuteWeights);
+
+    ofstream programFile(filesystem::path(dir) / "Program.txt", ios::binary | ios::trunc);
+    if (!programFile) {
+        error = "cannot write Program.txt in " + dir;
+        return false;
+    }
+    for (size_t i = 1; i <= options.shows; ++i) {
+        const CategoryProfile& category = categories[categoryChoice.pick(random)];
+        // Names stay unique through the sequence number
+        out += category.titles[random.below(category.titles.size())];
+        out += '_';
+        appendNumber(out, i);
+        out += ' ';
+        out += category.name;
+        out += ' ';
+        appendTwoDigits(out, static_cast<int>(hourChoice.pick(random)));
+        out += ':';
+        appendTwoDigits(out, static_cast<int>(minuteChoice.pick(random) * 15));
+        out += ' ';
+        appendNumber(out, category.durations[random.below(category.durations.size())]);
+        out += ' ';
+        out += dayNames[dayChoice.pick(random)];
+        out += ' ';
+        appendNumber(out, channelChoice.pick(random) + 1);
+        out += '\n';
+        if (!flushBlock(programFile, out, false)) break;
+    }
+    if (!flushBlock(programFile, out, true)) {
+        error = "cannot write Program.txt in " + dir;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,28 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// Synthetic Program.txt/Channel.txt catalogs for benchmarks. The output
+// depends only on the options, never on the platform, so the same seed gives
+// the same files everywhere. Categories, days, start hours and channels are
+// skewed the way a real EPG is: news and films dominate, evenings and
+// weekends are busier, and a few big channels carry most of the shows.
+struct GeneratorOptions {
+    size_t shows = 1000;
+    size_t channels = 0;        // 0 = about one per 150 shows, at least 20
+    uint64_t seed = 1;
+};
+
+// Number of channels a catalog generated with these options has
+size_t generatedChannelCount(const GeneratorOptions& options);
+
+// Writes Program.txt and Channel.txt into dir, creating it if needed. On
+// failure error says what went wrong.
+bool generateCatalog(const string& dir, const GeneratorOptions& options, string& error);
+
+#endif // GENERATOR_H
@@ -0,0 +1,63 @@
+#include "intern.h"
+#include <cctype>
+#include <mutex>
+
+StringPool categoryNames;
+StringPool channelCodes;
+
+StringPool::StringPool() : blocks(make_unique<unique_ptr<string[]>[]>(maxBlocks)) {}
+
+uint32_t StringPool::find(string_view s) const {
+    shared_lock lock(mutex);
+    auto it = ids.find(s);
+    return it == ids.end() ? noString : it->second;
+}
+
+uint32_t StringPool::intern(string_view s) {
+    uint32_t id = find(s);
+    if (id != noString) return id;
+
+    unique_lock lock(mutex);
+    auto it = ids.find(s);
+    if (it != ids.end()) return it->second;
+
+    id = count.load(memory_order_relaxed);
+    if (id / blockSize >= maxBlocks) return noString;
+    auto& block = blocks[id / blockSize];
+    if (!block) block = make_unique<string[]>(blockSize);
+    string& slot = block[id % blockSize];
+    slot = s;
+    ids.emplace(slot, id);
+    count.store(id + 1, memory_order_release);
+    return id;
+}
+
+static const string dayNames[daysPerWeek] = {
+    "Luni", "Marti", "Miercuri", "Joi", "Vineri", "Sambata", "Duminica"
+};
+
+static const char* const englishDayNames[daysPerWeek] = {
+    "monday", "tuesday", "wednesday", "thursday", "friday", "saturday", "sunday"
+};
+
+static bool equalsIgnoreCase(string_view a, string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (tolower(static_cast<unsigned char>(a[i])) != tolower(static_cast<unsigned char>(b[i]))) return false;
+    }
+    return true;
+}
+
+bool parseDay(string_view text, Day& day) {
+    for (int i = 0; i < daysPerWeek; ++i) {
+        if (equalsIgnoreCase(text, dayNames[i]) || equalsIgnoreCase(text, englishDayNames[i])) {
+            day = static_cast<Day>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const string& dayName(Day day) {
+    return dayNames[static_cast<int>(day)];
+}
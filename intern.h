@@ -0,0 +1,81 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using namespace std;
+
+constexpr uint32_t noString = UINT32_MAX;
+
+// Append-only dictionary giving each distinct string a small dense ID.
+// Strings never move once added, so str() needs no lock and its result stays
+// valid for the life of the program; intern() and find() are thread-safe.
+class StringPool {
+public:
+    StringPool();
+
+    uint32_t intern(string_view s);
+    uint32_t find(string_view s) const;        // noString if never interned
+    const string& str(uint32_t id) const { return blocks[id / blockSize][id % blockSize]; }
+    uint32_t size() const { return count.load(memory_order_acquire); }
+
+private:
+    static constexpr uint32_t blockSize = 1024;
+    static constexpr uint32_t maxBlocks = 1 << 16;
+
+    unique_ptr<unique_ptr<string[]>[]> blocks;
+    atomic<uint32_t> count {0};
+    unordered_map<string_view, uint32_t> ids;
+    mutable shared_mutex mutex;
+};
+
+// Remembers recent lookups in front of a shared pool so bulk loaders only
+// touch the pool's lock for strings they have not seen yet. The viewed text
+// must outlive the cache.
+class InternCache {
+public:
+    explicit InternCache(StringPool& pool) : pool(pool) {}
+
+    uint32_t intern(string_view s) {
+        auto it = seen.find(s);
+        if (it != seen.end()) return it->second;
+        uint32_t id = pool.intern(s);
+        seen.emplace(s, id);
+        return id;
+    }
+
+private:
+    StringPool& pool;
+    unordered_map<string_view, uint32_t> seen;
+};
+
+// Dictionaries shared by every show
+using CategoryId = uint32_t;
+using ChannelCodeId = uint32_t;
+extern StringPool categoryNames;
+extern StringPool channelCodes;
+
+enum class Day : uint8_t {
+    Monday,
+    Tuesday,
+    Wednesday,
+    Thursday,
+    Friday,
+    Saturday,
+    Sunday
+};
+
+constexpr int daysPerWeek = 7;
+
+// Accepts the Romanian names used in Program.txt (Luni ... Duminica) and the
+// English ones, in any letter case
+bool parseDay(string_view text, Day& day);
+const string& dayName(Day day);
+
+#endif // INTERN_H
@@ -0,0 +1,292 @@
+#include "journal.h"
+#include <filesystem>
+#include <fstream>
+#include <utility>
+#include "loader.h"
+#include "metrics.h"
+
+string formatStartTime(int hour, int minute) {
+    return (hour < 10 ? "0" + to_string(hour) : to_string(hour)) + ":" +
+           (minute < 10 ? "0" + to_string(minute) : to_string(minute));
+}
+
+string formatShowRecord(const show& s) {
+    return s.name + " " + categoryNames.str(s.category) + " " + formatStartTime(s.startHour, s.startMinute) + " " +
+           to_string(s.duration) + " " + dayName(s.dayOfWeek) + " " + channelCodes.str(s.channelCode);
+}
+
+string formatChannelRecord(const channel& c) {
+    return c.code + " " + c.name + " " + c.originCountry;
+}
+
+bool parseShowRecord(const string& line, show& s) {
+    ShowView view;
+    string reason;
+    if (!parseShowLine(line, view, reason)) return false;
+    s = toShow(view);
+    return true;
+}
+
+bool parseChannelRecord(const string& line, channel& c) {
+    ChannelView view;
+    string reason;
+    if (!parseChannelLine(line, view, reason)) return false;
+    c = toChannel(view);
+    return true;
+}
+
+Journal::Journal(string path, string programPath, string channelPath)
+    : path(move(path)), programPath(move(programPath)), channelPath(move(channelPath)), file(this->path) {
+    error_code ec;
+    auto existing = filesystem::file_size(this->path, ec);
+    if (!ec) bytes = existing;
+    // A crash in the middle of a write can leave a torn last line
+    if (bytes > 0) {
+        ifstream in(this->path, ios::binary);
+        in.seekg(-1, ios::end);
+        tornTail = in.get() != '\n';
+    }
+}
+
+Journal::~Journal() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (flusher.joinable()) flusher.join();
+    sync();
+}
+
+void Journal::setGroupCommit(size_t maxRecords, chrono::milliseconds maxDelay) {
+    {
+        lock_guard<mutex> guard(lock);
+        groupRecords = maxRecords;
+        groupDelay = maxDelay;
+    }
+    if (maxRecords > 0 && !flusher.joinable()) {
+        flusher = thread([this] { flushLoop(); });
+    }
+}
+
+bool Journal::sync() {
+    lock_guard<mutex> guard(lock);
+    return syncLocked();
+}
+
+bool Journal::syncLocked() {
+    if (unsynced == 0) return true;
+    OpTimer timer(Op::JournalSync);
+    timer.io(0, unsynced);
+    unsynced = 0;
+    return file.sync();
+}
+
+// Syncs each group once its oldest record has waited groupDelay
+void Journal::flushLoop() {
+    unique_lock<mutex> guard(lock);
+    while (!stopping) {
+        if (unsynced == 0) {
+            wake.wait(guard);
+            continue;
+        }
+        auto deadline = oldestUnsynced + groupDelay;
+        if (chrono::steady_clock::now() >= deadline) {
+            if (!syncLocked()) syncFailed = true;
+        } else {
+            wake.wait_until(guard, deadline);
+        }
+    }
+}
+
+// Writes whole records and syncs them as the commit policy asks. On failure
+// the file is cut back to its last good record, so a torn line never swallows
+// the next record and replay never brings back a change reported as failed.
+bool Journal::write(const string& records, size_t count) {
+    lock_guard<mutex> guard(lock);
+    bool ok;
+    {
+        OpTimer timer(Op::JournalWrite);
+        timer.io(records.size() + tornTail, count);
+        ok = (!tornTail || file.append("\n")) && file.append(records);     // ends a torn line first
+    }
+    if (ok) {
+        if (unsynced == 0) {
+            oldestUnsynced = chrono::steady_clock::now();
+            wake.notify_one();
+        }
+        unsynced += count;
+        if (groupRecords == 0 || batching || unsynced >= groupRecords) ok = syncLocked();
+    }
+    ok = !exchange(syncFailed, false) && ok;
+    if (ok) {
+        bytes += records.size() + tornTail;
+        tornTail = false;
+        return true;
+    }
+    if (!file.cut(bytes)) tornTail = true;
+    return false;
+}
+
+bool Journal::append(const string& record) {
+    pending += record;
+    pending += '\n';
+    pendingRecords++;
+    if (batching) return true;
+    bool ok = write(pending, pendingRecords);
+    pending.clear();
+    pendingRecords = 0;
+    return ok;
+}
+
+void Journal::beginBatch() {
+    batching = true;
+}
+
+bool Journal::endBatch() {
+    bool ok = pending.empty() || write(pending, pendingRecords);
+    batching = false;
+    pending.clear();
+    pendingRecords = 0;
+    return ok;
+}
+
+bool Journal::logInsertShow(const show& s) {
+    return append("+S " + formatShowRecord(s));
+}
+
+bool Journal::logUpdateShow(const string& oldName, const show& s) {
+    return append("=S " + oldName + " " + formatShowRecord(s));
+}
+
+bool Journal::logDeleteShow(const string& name) {
+    return append("-S " + name);
+}
+
+bool Journal::logInsertChannel(const channel& c) {
+    return append("+C " + formatChannelRecord(c));
+}
+
+bool Journal::logUpdateChannel(const channel& c) {
+    return append("=C " + formatChannelRecord(c));
+}
+
+bool Journal::logDeleteChannel(const string& code) {
+    return append("-C " + code);
+}
+
+// Overwrites the show stored under oldName (or under the new name when the
+// change was already applied), inserting it if neither exists
+static void upsertShow(Catalog& target, const string& oldName, show s) {
+    ShowId id = target.findShow(oldName);
+    ShowId holder = target.findShow(s.name);
+    if (id == noShow) {
+        id = holder;
+    } else if (holder != noShow && holder != id) {
+        target.eraseShow(holder);
+        id = target.findShow(oldName);  // the erase may have compacted ids
+    }
+    if (id == noShow) {
+        target.insertShow(move(s));
+    } else {
+        target.updateShow(id, move(s));
+    }
+}
+
+static void upsertChannel(Catalog& target, channel c) {
+    ChannelId id = target.findChannelByCode(c.code);
+    ChannelId holder = target.findChannelByName(c.name);
+    if (holder != noChannel && holder != id) {
+        target.eraseChannel(holder, ChannelErase::Cascade);
+        id = target.findChannelByCode(c.code);
+    }
+    if (id == noChannel) {
+        target.insertChannel(move(c));
+    } else {
+        target.updateChannel(id, move(c));
+    }
+}
+
+size_t Journal::replay(Catalog& target, size_t& skipped) {
+    OpTimer timer(Op::JournalReplay);
+    size_t applied = 0;
+    size_t read = 0;
+    skipped = 0;
+
+    ifstream in(path);
+    string line;
+    while (getline(in, line)) {
+        read += line.size() + 1;
+        if (line.size() < 3 || line[2] != ' ') {
+            if (!line.empty()) skipped++;
+            continue;
+        }
+        string op = line.substr(0, 2);
+        string rest = line.substr(3);
+        bool ok = true;
+
+        if (op == "+S") {
+            show s;
+            ok = parseShowRecord(rest, s);
+            if (ok) upsertShow(target, s.name, s);
+        } else if (op == "=S") {
+            size_t space = rest.find(' ');
+            show s;
+            ok = space != string::npos && parseShowRecord(rest.substr(space + 1), s);
+            if (ok) upsertShow(target, rest.substr(0, space), move(s));
+        } else if (op == "-S") {
+            target.eraseShow(target.findShow(rest));
+        } else if (op == "+C" || op == "=C") {
+            channel c;
+            ok = parseChannelRecord(rest, c);
+            if (ok) upsertChannel(target, move(c));
+        } else if (op == "-C") {
+            target.eraseChannel(target.findChannelByCode(rest), ChannelErase::Cascade);
+        } else {
+            ok = false;
+        }
+
+        if (ok) {
+            applied++;
+        } else {
+            skipped++;
+        }
+    }
+    timer.io(read, applied);
+    return applied;
+}
+
+void Journal::keepRejected(const LoadReport& programs, const LoadReport& channels) {
+    rejectedPrograms.clear();
+    for (const auto& error : programs.errors) rejectedPrograms += error.text + '\n';
+    rejectedChannels.clear();
+    for (const auto& error : channels.errors) rejectedChannels += error.text + '\n';
+}
+
+bool Journal::compact(const Catalog& source) {
+    OpTimer timer(Op::JournalCompact);
+    string programs;
+    for (const auto& s : source.shows()) {
+        programs += formatShowRecord(s);
+        programs += '\n';
+    }
+    programs += rejectedPrograms;
+    string channels;
+    for (const auto& c : source.channels()) {
+        channels += formatChannelRecord(c);
+        channels += '\n';
+    }
+    channels += rejectedChannels;
+
+    timer.io(programs.size() + channels.size(), source.showCount() + source.channelCount());
+    if (!writeFileAtomically(programPath, programs) || !writeFileAtomically(channelPath, channels)) {
+        return false;
+    }
+
+    // Only now that the snapshot is published may the journal be dropped
+    lock_guard<mutex> guard(lock);
+    unsynced = 0;
+    bytes = 0;
+    tornTail = false;
+    return file.truncate();
+}
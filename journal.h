@@ -0,0 +1,118 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "catalog.h"
+#include "durable.h"
+#include "loader.h"
+
+using namespace std;
+
+// Text records shared by the snapshot files and the journal
+string formatStartTime(int hour, int minute);
+string formatShowRecord(const show& s);
+string formatChannelRecord(const channel& c);
+bool parseShowRecord(const string& line, show& s);
+bool parseChannelRecord(const string& line, channel& c);
+
+// Append-only write-ahead journal of catalog mutations. Program.txt and
+// Channel.txt act as the last snapshot; every change since then is appended
+// here as one line:
+//
+//   +S <show record>            insert show
+//   =S <old name> <show record> update show
+//   -S <name>                   delete show
+//   +C <channel record>         insert channel
+//   =C <channel record>         update channel (keyed by code)
+//   -C <code>                   delete channel and the shows on it
+//
+// Replay is idempotent, so a crash between publishing a snapshot and
+// truncating the journal only replays changes the snapshot already has.
+//
+// Every record is written to the OS as it is logged, so it survives the
+// process dying. By default each one is also fsynced before the call returns.
+// With group commit, one fsync covers up to maxRecords records, and a
+// background thread syncs any stragglers within maxDelay. A power loss can
+// then cost at most that window of changes.
+//
+// The log calls and endBatch return false when the records could not be
+// written or synced as the commit policy asks; the change must then not be
+// reported as saved, and the records are cut from the file again. A failed
+// background sync fails the next write, since the records it covered are not
+// known to be on disk.
+class Journal {
+public:
+    Journal(string path, string programPath, string channelPath);
+    ~Journal();
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    bool logInsertShow(const show& s);
+    bool logUpdateShow(const string& oldName, const show& s);
+    bool logDeleteShow(const string& name);
+    bool logInsertChannel(const channel& c);
+    bool logUpdateChannel(const channel& c);
+    bool logDeleteChannel(const string& code);
+
+    // Records logged between beginBatch and endBatch are buffered and reach
+    // the file in one write and one fsync, whose result endBatch returns
+    void beginBatch();
+    bool endBatch();
+
+    // maxRecords 0 (the default) syncs every record on its own
+    void setGroupCommit(size_t maxRecords, chrono::milliseconds maxDelay);
+    bool sync();        // makes every record logged so far durable
+
+    // Applies every journal record on top of the loaded snapshot. Returns the
+    // number of records applied; torn or malformed lines are counted in skipped.
+    size_t replay(Catalog& target, size_t& skipped);
+
+    // Publishes the catalog as the new snapshot and empties the journal
+    bool compact(const Catalog& source);
+
+    // Lines the snapshot files were loaded with but the catalog rejected.
+    // compact writes them back after the catalog's records, so rewriting the
+    // files never throws away data someone still has to fix by hand.
+    void keepRejected(const LoadReport& programs, const LoadReport& channels);
+
+    uintmax_t size() const { return bytes; }
+    bool needsCompaction() const { return bytes >= compactionThreshold; }
+    void setCompactionThreshold(uintmax_t threshold) { compactionThreshold = threshold; }
+
+private:
+    bool append(const string& record);
+    bool write(const string& records, size_t count);
+    bool syncLocked();
+    void flushLoop();
+
+    string path;
+    string programPath;
+    string channelPath;
+    string rejectedPrograms;        // raw lines, newline-terminated
+    string rejectedChannels;
+    AppendFile file;
+    bool batching = false;
+    string pending;
+    size_t pendingRecords = 0;
+    uintmax_t bytes = 0;                        // up to the end of the last good record
+    bool tornTail = false;                      // the file ends in a partial line
+    uintmax_t compactionThreshold = 4 * 1024 * 1024;
+
+    // Group commit state, guarded by lock
+    mutex lock;
+    condition_variable wake;
+    size_t groupRecords = 0;
+    chrono::milliseconds groupDelay{0};
+    size_t unsynced = 0;                        // records written but not yet fsynced
+    bool syncFailed = false;                    // by the flusher; reported by the next write
+    chrono::steady_clock::time_point oldestUnsynced;
+    thread flusher;
+    bool stopping = false;
+};
+
+#endif // JOURNAL_H
@@ -0,0 +1,26 @@
+#include "lineup.h"
+#include "catalog.h"
+#include "cow.h"
+
+void ChannelLineup::add(uint32_t id, const show& s) {
+    if (s.channelCode >= lists.size()) lists.resize(s.channelCode + 1);
+    unshare(lists[s.channelCode]).insert(id);
+}
+
+void ChannelLineup::remove(uint32_t id, const show& s) {
+    if (s.channelCode >= lists.size() || !lists[s.channelCode]) return;
+    auto& list = lists[s.channelCode];
+    unshare(list).erase(id);
+    if (list->size() == 0) list.reset();
+}
+
+void ChannelLineup::remap(const vector<uint32_t>& newIds) {
+    for (auto& list : lists) {
+        if (list) unshare(list).remap(newIds);
+    }
+}
+
+const PostingList& ChannelLineup::of(ChannelCodeId code) const {
+    static const PostingList none;
+    return code < lists.size() && lists[code] ? *lists[code] : none;
+}
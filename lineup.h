@@ -0,0 +1,30 @@
+#ifndef LINEUP_H
+#define LINEUP_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "intern.h"
+#include "search.h"
+
+using namespace std;
+
+struct show;
+
+// Show IDs by channel code, each channel's in ascending ID order, so the k
+// shows on a channel are found in O(k) instead of by a pass over the table.
+// Each channel's list is a copy-on-write PostingList (see search.h), so a
+// copy shares the channels neither side has changed.
+class ChannelLineup {
+public:
+    void add(uint32_t id, const show& s);
+    void remove(uint32_t id, const show& s);
+    void remap(const vector<uint32_t>& newIds);     // after the catalog compacts
+
+    const PostingList& of(ChannelCodeId code) const;     // empty for codes without shows
+
+private:
+    vector<shared_ptr<PostingList>> lists;      // by ChannelCodeId; null while empty
+};
+
+#endif // LINEUP_H
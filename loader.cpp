@@ -0,0 +1,398 @@
+#include "loader.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include "metrics.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const string& path) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat st {};
+    if (::fstat(fd, &st) == 0) {
+        opened = true;
+        length = static_cast<size_t>(st.st_size);
+        if (length > 0) {
+            void* p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                ::madvise(p, length, MADV_SEQUENTIAL);
+                data = static_cast<const char*>(p);
+                mapped = true;
+            } else {
+                opened = false;
+                length = 0;
+            }
+        }
+    }
+    ::close(fd);
+    if (opened) return;
+#endif
+    // Fallback: read the whole file into memory
+    ifstream in(path, ios::binary);
+    if (!in) return;
+    ostringstream ss;
+    ss << in.rdbuf();
+    buffer = ss.str();
+    data = buffer.data();
+    length = buffer.size();
+    opened = true;
+}
+
+MappedFile::~MappedFile() {
+    release();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this == &other) return *this;
+    release();
+    opened = other.opened;
+    mapped = other.mapped;
+    length = other.length;
+    buffer = move(other.buffer);
+    data = mapped ? other.data : buffer.data();
+    other.data = nullptr;
+    other.length = 0;
+    other.opened = false;
+    other.mapped = false;
+    return *this;
+}
+
+void MappedFile::release() {
+#ifndef _WIN32
+    if (mapped) ::munmap(const_cast<char*>(data), length);
+#endif
+    data = nullptr;
+    length = 0;
+    opened = false;
+    mapped = false;
+    buffer.clear();
+}
+
+// Calls f(lineNumber, line) for every line, without the trailing \r\n
+template <typename F>
+static void forEachLine(string_view text, F&& f) {
+    size_t lineNo = 0;
+    while (!text.empty()) {
+        const char* nl = static_cast<const char*>(memchr(text.data(), '\n', text.size()));
+        size_t len = nl ? static_cast<size_t>(nl - text.data()) : text.size();
+        string_view line = text.substr(0, len);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        f(++lineNo, line);
+        text.remove_prefix(nl ? len + 1 : len);
+    }
+}
+
+static size_t countLines(string_view text) {
+    size_t n = static_cast<size_t>(count(text.begin(), text.end(), '\n'));
+    return (!text.empty() && text.back() != '\n') ? n + 1 : n;
+}
+
+// Splits the next whitespace-separated token off the front of line
+static string_view nextToken(string_view& line) {
+    size_t start = line.find_first_not_of(" \t");
+    if (start == string_view::npos) {
+        line = {};
+        return {};
+    }
+    size_t end = line.find_first_of(" \t", start);
+    if (end == string_view::npos) end = line.size();
+    string_view token = line.substr(start, end - start);
+    line.remove_prefix(end);
+    return token;
+}
+
+static bool parseInt(string_view token, int& value) {
+    auto [ptr, ec] = from_chars(token.data(), token.data() + token.size(), value);
+    return ec == errc() && ptr == token.data() + token.size();
+}
+
+static bool isBlank(string_view line) {
+    return line.find_first_not_of(" \t") == string_view::npos;
+}
+
+bool parseShowLine(string_view line, ShowView& view, string& reason) {
+    string_view fields[6];
+    for (auto& field : fields) {
+        field = nextToken(line);
+        if (field.empty()) {
+            reason = "expected 6 fields";
+            return false;
+        }
+    }
+    if (!nextToken(line).empty()) {
+        reason = "unexpected extra fields";
+        return false;
+    }
+
+    string_view startTime = fields[2];
+    size_t colon = startTime.find(':');
+    if (colon == string_view::npos ||
+        !parseInt(startTime.substr(0, colon), view.startHour) ||
+        !parseInt(startTime.substr(colon + 1), view.startMinute) ||
+        view.startHour < 0 || view.startHour > 23 || view.startMinute < 0 || view.startMinute > 59) {
+        reason = "invalid start time '" + string(startTime) + "'";
+        return false;
+    }
+    if (!parseInt(fields[3], view.duration) || view.duration <= 0) {
+        reason = "invalid duration '" + string(fields[3]) + "'";
+        return false;
+    }
+
+    if (!parseDay(fields[4], view.dayOfWeek)) {
+        reason = "unknown day '" + string(fields[4]) + "'";
+        return false;
+    }
+
+    view.name = fields[0];
+    view.category = fields[1];
+    view.channelCode = fields[5];
+    return true;
+}
+
+bool parseChannelLine(string_view line, ChannelView& view, string& reason) {
+    view.code = nextToken(line);
+    view.name = nextToken(line);
+    view.originCountry = nextToken(line);
+    if (view.originCountry.empty()) {
+        reason = "expected 3 fields";
+        return false;
+    }
+    if (!nextToken(line).empty()) {
+        reason = "unexpected extra fields";
+        return false;
+    }
+    return true;
+}
+
+show toShow(const ShowView& view, InternCache& categories, InternCache& codes) {
+    show s;
+    s.name = view.name;
+    s.category = categories.intern(view.category);
+    s.channelCode = codes.intern(view.channelCode);
+    s.duration = view.duration;
+    s.startHour = static_cast<uint8_t>(view.startHour);
+    s.startMinute = static_cast<uint8_t>(view.startMinute);
+    s.dayOfWeek = view.dayOfWeek;
+    return s;
+}
+
+show toShow(const ShowView& view) {
+    show s;
+    s.name = view.name;
+    s.category = categoryNames.intern(view.category);
+    s.channelCode = channelCodes.intern(view.channelCode);
+    s.duration = view.duration;
+    s.startHour = static_cast<uint8_t>(view.startHour);
+    s.startMinute = static_cast<uint8_t>(view.startMinute);
+    s.dayOfWeek = view.dayOfWeek;
+    return s;
+}
+
+channel toChannel(const ChannelView& view) {
+    channel c;
+    c.code = view.code;
+    c.name = view.name;
+    c.originCountry = view.originCountry;
+    return c;
+}
+
+ProgramFileView viewPrograms(const string& path) {
+    ProgramFileView result;
+    result.file = MappedFile(path);
+    string_view text = result.file.contents();
+    result.shows.reserve(countLines(text));
+
+    string reason;
+    forEachLine(text, [&](size_t lineNo, string_view line) {
+        result.report.lines = lineNo;
+        if (isBlank(line)) return;
+        ShowView view;
+        if (parseShowLine(line, view, reason)) {
+            result.shows.push_back(view);
+            result.report.loaded++;
+        } else {
+            result.report.errors.push_back({lineNo, reason, string(line)});
+        }
+    });
+    return result;
+}
+
+ChannelFileView viewChannels(const string& path) {
+    ChannelFileView result;
+    result.file = MappedFile(path);
+    string_view text = result.file.contents();
+    result.channels.reserve(countLines(text));
+
+    string reason;
+    forEachLine(text, [&](size_t lineNo, string_view line) {
+        result.report.lines = lineNo;
+        if (isBlank(line)) return;
+        ChannelView view;
+        if (parseChannelLine(line, view, reason)) {
+            result.channels.push_back(view);
+            result.report.loaded++;
+        } else {
+            result.report.errors.push_back({lineNo, reason, string(line)});
+        }
+    });
+    return result;
+}
+
+// Shows parsed from one chunk of Program.txt, with line numbers local to the chunk
+struct ParsedChunk {
+    vector<show> shows;
+    vector<size_t> showLines;
+    vector<string_view> showText;
+    vector<LoadError> errors;
+    size_t lines = 0;
+};
+
+static void parseProgramChunk(string_view text, ParsedChunk& out) {
+    out.shows.reserve(countLines(text));
+    out.showLines.reserve(out.shows.capacity());
+    out.showText.reserve(out.shows.capacity());
+
+    InternCache categories(categoryNames);
+    InternCache codes(channelCodes);
+    string reason;
+    forEachLine(text, [&](size_t lineNo, string_view line) {
+        out.lines = lineNo;
+        if (isBlank(line)) return;
+        ShowView view;
+        if (parseShowLine(line, view, reason)) {
+            out.shows.push_back(toShow(view, categories, codes));
+            out.showLines.push_back(lineNo);
+            out.showText.push_back(line);
+        } else {
+            out.errors.push_back({lineNo, reason, string(line)});
+        }
+    });
+}
+
+// Splits text into roughly equal chunks that each end on a line boundary
+static vector<string_view> splitAtLines(string_view text, size_t chunks) {
+    vector<string_view> result;
+    size_t target = text.size() / chunks + 1;
+    while (!text.empty()) {
+        size_t cut = min(text.size(), target);
+        if (cut < text.size()) {
+            size_t nl = text.find('\n', cut - 1);
+            cut = nl == string_view::npos ? text.size() : nl + 1;
+        }
+        result.push_back(text.substr(0, cut));
+        text.remove_prefix(cut);
+    }
+    return result;
+}
+
+unsigned loadThreadCount(const LoadOptions& options, size_t bytes) {
+    unsigned threads = options.threads;
+    if (threads == 0) {
+        threads = max(1u, thread::hardware_concurrency());
+        // Small files are not worth the thread start-up cost
+        size_t worthwhile = max<size_t>(1, bytes / max<size_t>(1, options.minChunkBytes));
+        threads = static_cast<unsigned>(min<size_t>(threads, worthwhile));
+    }
+    return threads;
+}
+
+LoadReport loadPrograms(const string& path, Catalog& target, const LoadOptions& options) {
+    OpTimer timer(Op::LoadPrograms);
+    MappedFile file(path);
+    string_view text = file.contents();
+
+    // Parse chunks into per-thread buffers, then merge them in file order so
+    // the result is identical to a sequential load
+    vector<string_view> pieces = splitAtLines(text, loadThreadCount(options, text.size()));
+    vector<ParsedChunk> parsed(pieces.size());
+    if (pieces.size() <= 1) {
+        if (!pieces.empty()) parseProgramChunk(pieces[0], parsed[0]);
+    } else {
+        vector<thread> workers;
+        workers.reserve(pieces.size() - 1);
+        for (size_t i = 1; i < pieces.size(); ++i) {
+            workers.emplace_back(parseProgramChunk, pieces[i], ref(parsed[i]));
+        }
+        parseProgramChunk(pieces[0], parsed[0]);
+        for (auto& worker : workers) worker.join();
+    }
+
+    size_t total = 0;
+    for (const auto& chunk : parsed) total += chunk.shows.size();
+    target.reserve(target.showCount() + total, target.channelCount());
+
+    LoadReport report;
+    size_t lineBase = 0;
+    for (auto& chunk : parsed) {
+        for (auto& error : chunk.errors) {
+            report.errors.push_back({lineBase + error.line, move(error.reason), move(error.text)});
+        }
+        for (size_t i = 0; i < chunk.shows.size(); ++i) {
+            string name = chunk.shows[i].name;
+            if (target.insertShow(move(chunk.shows[i])) == noShow) {
+                report.errors.push_back({lineBase + chunk.showLines[i], "duplicate show name '" + name + "'",
+                                         string(chunk.showText[i])});
+            } else {
+                report.loaded++;
+            }
+        }
+        lineBase += chunk.lines;
+        chunk = ParsedChunk{};
+    }
+    report.lines = lineBase;
+    ranges::stable_sort(report.errors, {}, &LoadError::line);
+    timer.io(text.size(), report.loaded);
+    return report;
+}
+
+LoadReport loadChannels(const string& path, Catalog& target) {
+    OpTimer timer(Op::LoadChannels);
+    MappedFile file(path);
+    string_view text = file.contents();
+    target.reserve(target.showCount(), target.channelCount() + countLines(text));
+
+    LoadReport report;
+    string reason;
+    forEachLine(text, [&](size_t lineNo, string_view line) {
+        report.lines = lineNo;
+        if (isBlank(line)) return;
+        ChannelView view;
+        if (!parseChannelLine(line, view, reason)) {
+            report.errors.push_back({lineNo, reason, string(line)});
+        } else if (target.insertChannel(toChannel(view)) == noChannel) {
+            report.errors.push_back({lineNo, "duplicate channel code or name '" + string(view.code) + "'", string(line)});
+        } else {
+            report.loaded++;
+        }
+    });
+    timer.io(text.size(), report.loaded);
+    return report;
+}
+
+void printLoadReport(const string& fileName, const LoadReport& report) {
+    if (report.errors.empty()) return;
+
+    const size_t shown = 10;
+    cout << fileName << ": skipped " << report.errors.size() << " malformed line(s)." << endl;
+    for (size_t i = 0; i < report.errors.size() && i < shown; ++i) {
+        cout << "  line " << report.errors[i].line << ": " << report.errors[i].reason << endl;
+    }
+    if (report.errors.size() > shown) {
+        cout << "  ..." << endl;
+    }
+}
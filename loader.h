@@ -0,0 +1,109 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "catalog.h"
+
+using namespace std;
+
+// Read-only view of a whole file, memory-mapped where the platform allows it
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const string& path);
+    ~MappedFile();
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return opened; }
+    string_view contents() const { return {data, length}; }
+
+private:
+    void release();
+
+    const char* data = nullptr;
+    size_t length = 0;
+    bool opened = false;
+    bool mapped = false;
+    string buffer;      // used when the file cannot be mapped
+};
+
+// One Program.txt record, with string fields pointing into the source text
+struct ShowView {
+    string_view name;
+    string_view category;
+    int startHour = 0;
+    int startMinute = 0;
+    int duration = 0;
+    Day dayOfWeek = Day::Monday;
+    string_view channelCode;
+};
+
+// One Channel.txt record, with string fields pointing into the source text
+struct ChannelView {
+    string_view code;
+    string_view name;
+    string_view originCountry;
+};
+
+struct LoadError {
+    size_t line;        // 1-based
+    string reason;
+    string text;        // the line as read, so it can be written back
+};
+
+struct LoadReport {
+    size_t lines = 0;
+    size_t loaded = 0;
+    vector<LoadError> errors;
+};
+
+// Tokenize one record in place. On failure reason says what was wrong.
+bool parseShowLine(string_view line, ShowView& view, string& reason);
+bool parseChannelLine(string_view line, ChannelView& view, string& reason);
+// Converting a view interns its category and channel code; bulk loaders pass
+// their own caches to keep off the shared dictionaries' locks
+show toShow(const ShowView& view);
+show toShow(const ShowView& view, InternCache& categories, InternCache& codes);
+channel toChannel(const ChannelView& view);
+
+struct LoadOptions {
+    unsigned threads = 0;               // parser threads for Program.txt, 0 = automatic
+    size_t minChunkBytes = 4 << 20;     // automatic mode gives each thread at least this much
+};
+
+// Number of parser threads a load of the given size will use
+unsigned loadThreadCount(const LoadOptions& options, size_t bytes);
+
+// Load Program.txt/Channel.txt into the catalog, reporting malformed lines.
+// Large program files are split at line boundaries and parsed in parallel;
+// the chunks are merged in file order, so the result matches a sequential load.
+LoadReport loadPrograms(const string& path, Catalog& target, const LoadOptions& options = {});
+LoadReport loadChannels(const string& path, Catalog& target);
+
+// Read-only sessions can keep the records as views into the mapping instead
+// of copying them into the catalog; the views live as long as the file does.
+struct ProgramFileView {
+    MappedFile file;
+    vector<ShowView> shows;
+    LoadReport report;
+};
+
+struct ChannelFileView {
+    MappedFile file;
+    vector<ChannelView> channels;
+    LoadReport report;
+};
+
+ProgramFileView viewPrograms(const string& path);
+ChannelFileView viewChannels(const string& path);
+
+// Prints a short summary of the malformed lines in a load report
+void printLoadReport(const string& fileName, const LoadReport& report);
+
+#endif // LOADER_H
@@ -1,41 +1,79 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <cstdlib>
+#include <cstring>
 #include "tvmodule.h"
+#include "cli.h"
+#include "loader.h"
+#include "metrics.h"
+#include "arena.h"
 
 using namespace std;
 
-int main() {
+int main(int argc, char* argv[]) {
     // Initialize storage files
     if (!fileExists("Program.txt")) createFileIfNotExists("Program.txt");
     if (!fileExists("Channel.txt")) createFileIfNotExists("Channel.txt");
 
-    // Load programs
-    ifstream pFile("Program.txt");
-    string line;
-    while (getline(pFile, line)) {
-        show s;
-        string startTime;
-        stringstream ss(line);
-        ss >> s.name >> s.category >> startTime >> s.duration >> s.dayOfWeek >> s.channelCode;
-        s.startHour = stoi(startTime.substr(0, 2));
-        s.startMinute = stoi(startTime.substr(3, 2));
-        programs.push_back(s);
-    }
-    pFile.close();
-
-    // Load channels
-    ifstream cFile("Channel.txt");
-    while (getline(cFile, line)) {
-        channel c;
-        stringstream ss(line);
-        ss >> c.code >> c.name >> c.originCountry;
-        channels.push_back(c);
-    }
-    cFile.close();
-
-    // Clear screen before starting the program
-    clearScreen();
+    // PRACTICA_METRICS_FILE=PATH[,SECONDS] rewrites PATH with the operation
+    // metrics as JSON every SECONDS (default 10) and once more at exit
+    if (const char* dump = getenv("PRACTICA_METRICS_FILE")) {
+        string path = dump;
+        int seconds = 10;
+        size_t comma = path.find(',');
+        if (comma != string::npos) {
+            seconds = atoi(path.c_str() + comma + 1);
+            path.resize(comma);
+        }
+        startMetricsDump(path, chrono::seconds(max(1, seconds)));
+    }
+
+    // PRACTICA_ARENA=0 makes the indexes allocate entry by entry instead of
+    // from arena blocks, for comparing the two
+    if (const char* arena = getenv("PRACTICA_ARENA")) {
+        setArenasEnabled(strcmp(arena, "0") != 0);
+    }
+
+    // Load programs and channels; PRACTICA_LOAD_THREADS sets the number of
+    // parser threads for Program.txt (0 or unset picks one per core for large files)
+    LoadOptions loadOptions;
+    if (const char* threads = getenv("PRACTICA_LOAD_THREADS")) {
+        loadOptions.threads = static_cast<unsigned>(max(0, atoi(threads)));
+    }
+    LoadReport programReport = loadPrograms("Program.txt", catalog, loadOptions);
+    LoadReport channelReport = loadChannels("Channel.txt", catalog);
+    printLoadReport("Program.txt", programReport);
+    printLoadReport("Channel.txt", channelReport);
+    journal.keepRejected(programReport, channelReport);
+
+    // PRACTICA_GROUP_COMMIT=RECORDS[,MILLISECONDS] lets one fsync of the journal
+    // cover up to RECORDS changes, none left unsynced for longer than
+    // MILLISECONDS (default 50); unset, every change is synced on its own
+    if (const char* group = getenv("PRACTICA_GROUP_COMMIT")) {
+        int records = atoi(group);
+        const char* comma = strchr(group, ',');
+        int delay = comma ? atoi(comma + 1) : 50;
+        if (records > 0) journal.setGroupCommit(static_cast<size_t>(records), chrono::milliseconds(max(1, delay)));
+    }
+
+    // Replay changes made since the snapshot files were last written
+    size_t skipped = 0;
+    size_t replayed = journal.replay(catalog, skipped);
+    if (skipped > 0) {
+        cout << "Skipped " << skipped << " unreadable journal record(s)." << endl;
+    }
+    if (replayed > 0 && journal.needsCompaction()) {
+        journal.compact(catalog);
+    }
+
+    // With a command on the command line, run it (or a script) and exit
+    if (argc > 1) {
+        return runCli(argc, argv);
+    }
+
+    // Clear screen before starting the program, unless there are load problems to read
+    if (programReport.errors.empty() && channelReport.errors.empty()) {
+        clearScreen();
+    }
     
     // Start interface
     showMenu();
@@ -0,0 +1,262 @@
+#include "metrics.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include "durable.h"
+
+static const char* const opNames[] = {
+    "add-show", "edit-show", "delete-show", "add-channel", "edit-channel", "delete-channel", "import-shows",
+    "listing", "query", "search", "report", "broadcast-summary", "server-read", "server-write",
+    "load-programs", "load-channels", "journal-write", "journal-sync", "journal-replay", "journal-compact",
+    "file-write", "snapshot-write", "snapshot-read",
+};
+static_assert(size(opNames) == size_t(Op::Count), "every operation needs a name");
+
+const char* opName(Op op) {
+    return opNames[static_cast<size_t>(op)];
+}
+
+size_t LatencyBuckets::index(uint64_t nanos) {
+    constexpr uint64_t sub = uint64_t(1) << subBits;
+    if (nanos < sub) return static_cast<size_t>(nanos);
+    nanos = min(nanos, (uint64_t(1) << maxExponent) - 1);
+    unsigned exponent = static_cast<unsigned>(bit_width(nanos)) - 1;
+    uint64_t within = (nanos >> (exponent - subBits)) & (sub - 1);
+    return ((exponent - subBits + 1) << subBits) + within;
+}
+
+uint64_t LatencyBuckets::upperBound(size_t index) {
+    constexpr uint64_t sub = uint64_t(1) << subBits;
+    if (index < sub) return index;
+    unsigned exponent = static_cast<unsigned>(index >> subBits) + subBits - 1;
+    uint64_t within = index & (sub - 1);
+    return ((sub + within + 1) << (exponent - subBits)) - 1;
+}
+
+uint64_t OpMetrics::percentileNanos(double p) const {
+    if (count == 0) return 0;
+    uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(p / 100 * static_cast<double>(count) + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) return min(LatencyBuckets::upperBound(i), maxNanos);
+    }
+    return maxNanos;
+}
+
+#if PRACTICA_METRICS
+
+// One thread's counters. Only the owning thread writes them, with plain
+// loads and stores rather than locked increments; collectors read them
+// concurrently and may see a call half counted, which is harmless.
+struct OpCounters {
+    atomic<uint64_t> count {0};
+    atomic<uint64_t> totalNanos {0};
+    atomic<uint64_t> maxNanos {0};
+    atomic<uint64_t> bytes {0};
+    atomic<uint64_t> records {0};
+    atomic<uint64_t> buckets[LatencyBuckets::count] {};
+};
+
+struct ThreadMetrics {
+    OpCounters ops[size_t(Op::Count)];
+};
+
+static void bump(atomic<uint64_t>& counter, uint64_t amount) {
+    counter.store(counter.load(memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+// Live threads' counters plus the totals of threads that have exited. Never
+// destroyed, so threads still running during static destruction stay safe.
+struct Registry {
+    mutex lock;
+    vector<ThreadMetrics*> live;
+    ThreadMetrics retired;
+};
+
+static Registry& registry() {
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+static void addInto(OpCounters& into, const OpCounters& from) {
+    bump(into.count, from.count.load(memory_order_relaxed));
+    bump(into.totalNanos, from.totalNanos.load(memory_order_relaxed));
+    bump(into.bytes, from.bytes.load(memory_order_relaxed));
+    bump(into.records, from.records.load(memory_order_relaxed));
+    into.maxNanos.store(max(into.maxNanos.load(memory_order_relaxed), from.maxNanos.load(memory_order_relaxed)),
+                        memory_order_relaxed);
+    for (size_t b = 0; b < LatencyBuckets::count; ++b) {
+        bump(into.buckets[b], from.buckets[b].load(memory_order_relaxed));
+    }
+}
+
+// Enrolls the thread on its first recorded call and folds its counters into
+// the retired totals when it exits. Calls made after that, by destructors
+// that outlive the slot (the dump at exit writing its file), are dropped.
+class ThreadSlot {
+public:
+    ThreadMetrics* get() {
+        if (!metrics && !tornDown) {
+            metrics = new ThreadMetrics;
+            Registry& r = registry();
+            lock_guard<mutex> guard(r.lock);
+            r.live.push_back(metrics);
+        }
+        return metrics;
+    }
+
+    ~ThreadSlot() {
+        tornDown = true;
+        if (!metrics) return;
+        Registry& r = registry();
+        {
+            lock_guard<mutex> guard(r.lock);
+            for (size_t op = 0; op < size_t(Op::Count); ++op) addInto(r.retired.ops[op], metrics->ops[op]);
+            erase(r.live, metrics);
+        }
+        delete metrics;
+        metrics = nullptr;
+    }
+
+private:
+    ThreadMetrics* metrics = nullptr;
+    bool tornDown = false;
+};
+
+static thread_local ThreadSlot threadSlot;
+
+void recordOp(Op op, uint64_t nanos, uint64_t bytes, uint64_t records) {
+    ThreadMetrics* metrics = threadSlot.get();
+    if (!metrics) return;
+    OpCounters& c = metrics->ops[static_cast<size_t>(op)];
+    bump(c.count, 1);
+    bump(c.totalNanos, nanos);
+    if (nanos > c.maxNanos.load(memory_order_relaxed)) c.maxNanos.store(nanos, memory_order_relaxed);
+    if (bytes) bump(c.bytes, bytes);
+    if (records) bump(c.records, records);
+    bump(c.buckets[LatencyBuckets::index(nanos)], 1);
+}
+
+vector<OpMetrics> collectMetrics() {
+    auto totals = make_unique<ThreadMetrics>();     // too big for the stack
+    {
+        Registry& r = registry();
+        lock_guard<mutex> guard(r.lock);
+        for (size_t op = 0; op < size_t(Op::Count); ++op) {
+            addInto(totals->ops[op], r.retired.ops[op]);
+            for (ThreadMetrics* t : r.live) addInto(totals->ops[op], t->ops[op]);
+        }
+    }
+
+    vector<OpMetrics> result;
+    for (size_t op = 0; op < size_t(Op::Count); ++op) {
+        const OpCounters& c = totals->ops[op];
+        if (c.count.load() == 0) continue;
+        OpMetrics m;
+        m.op = static_cast<Op>(op);
+        m.count = c.count.load();
+        m.totalNanos = c.totalNanos.load();
+        m.maxNanos = c.maxNanos.load();
+        m.bytes = c.bytes.load();
+        m.records = c.records.load();
+        m.buckets.resize(LatencyBuckets::count);
+        for (size_t b = 0; b < LatencyBuckets::count; ++b) m.buckets[b] = c.buckets[b].load();
+        result.push_back(move(m));
+    }
+    return result;
+}
+
+// Rewrites the dump file on its own thread until the program exits
+class MetricsDumper {
+public:
+    ~MetricsDumper() {
+        if (!worker.joinable()) return;
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        worker.join();
+        dump();
+    }
+
+    void start(const string& dumpPath, chrono::seconds dumpInterval) {
+        if (worker.joinable()) return;
+        path = dumpPath;
+        interval = dumpInterval;
+        worker = thread([this] { run(); });
+    }
+
+private:
+    void run() {
+        unique_lock<mutex> guard(lock);
+        while (!wake.wait_for(guard, interval, [this] { return stopping; })) {
+            guard.unlock();
+            dump();
+            guard.lock();
+        }
+    }
+
+    void dump() const {
+        string json;
+        metricsTable(collectMetrics()).render(TableFormat::Json, json);
+        writeFileAtomically(path, json);
+    }
+
+    string path;
+    chrono::seconds interval {10};
+    thread worker;
+    mutex lock;
+    condition_variable wake;
+    bool stopping = false;
+};
+
+static MetricsDumper dumper;
+
+void startMetricsDump(const string& path, chrono::seconds interval) {
+    dumper.start(path, max(interval, chrono::seconds(1)));
+}
+
+#else
+
+vector<OpMetrics> collectMetrics() {
+    return {};
+}
+
+void startMetricsDump(const string&, chrono::seconds) {}
+
+#endif
+
+static string micros(uint64_t nanos) {
+    ostringstream text;
+    text << fixed << setprecision(1) << static_cast<double>(nanos) / 1000;
+    return text.str();
+}
+
+Table metricsTable(const vector<OpMetrics>& metrics) {
+    Table table({{"Operation", "operation"},
+                 {"Calls", "calls", "", true},
+                 {"Mean", "mean_us", " us", true},
+                 {"p50", "p50_us", " us", true},
+                 {"p90", "p90_us", " us", true},
+                 {"p99", "p99_us", " us", true},
+                 {"p99.9", "p999_us", " us", true},
+                 {"Max", "max_us", " us", true},
+                 {"Bytes", "bytes", "", true},
+                 {"Records", "records", "", true}});
+    for (const auto& m : metrics) {
+        table.cell(opName(m.op)).number(static_cast<int64_t>(m.count));
+        table.cell(micros(m.totalNanos / max<uint64_t>(1, m.count)));
+        for (double p : {50.0, 90.0, 99.0, 99.9}) table.cell(micros(m.percentileNanos(p)));
+        table.cell(micros(m.maxNanos));
+        table.number(static_cast<int64_t>(m.bytes)).number(static_cast<int64_t>(m.records));
+    }
+    return table;
+}
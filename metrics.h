@@ -0,0 +1,124 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "table.h"
+
+using namespace std;
+
+// Building with PRACTICA_METRICS=0 compiles every timer and counter below
+// down to nothing
+#ifndef PRACTICA_METRICS
+#define PRACTICA_METRICS 1
+#endif
+
+// Instrumented operations, in the order they are reported
+enum class Op : uint8_t {
+    AddShow,
+    EditShow,
+    DeleteShow,
+    AddChannel,
+    EditChannel,
+    DeleteChannel,
+    ImportShows,
+    Listing,            // all shows/channels and their pages
+    Query,
+    Search,
+    Report,             // day, longest, shortest, average, stats, what's on, conflicts
+    BroadcastSummary,
+    ServerRead,
+    ServerWrite,
+    LoadPrograms,       // file reads and writes also count bytes and records
+    LoadChannels,
+    JournalWrite,
+    JournalSync,
+    JournalReplay,
+    JournalCompact,
+    FileWrite,          // every atomic whole-file write
+    SnapshotWrite,
+    SnapshotRead,
+    Count
+};
+
+const char* opName(Op op);
+
+// Latency histogram with HDR-style log-linear buckets: each power of two is
+// split into 8 equal buckets, so a recorded value is off by at most 12.5%
+// whatever its magnitude. Values are nanoseconds, capped at about 18 minutes.
+struct LatencyBuckets {
+    static constexpr unsigned subBits = 3;
+    static constexpr unsigned maxExponent = 40;
+    static constexpr size_t count = (maxExponent - subBits + 1) << subBits;
+
+    static size_t index(uint64_t nanos);
+    static uint64_t upperBound(size_t index);       // largest value in the bucket
+};
+
+// Totals for one operation, merged over every thread that ran it
+struct OpMetrics {
+    Op op;
+    uint64_t count = 0;
+    uint64_t totalNanos = 0;
+    uint64_t maxNanos = 0;
+    uint64_t bytes = 0;
+    uint64_t records = 0;
+    vector<uint64_t> buckets;
+
+    // The value p percent of the calls took no longer than, to bucket precision
+    uint64_t percentileNanos(double p) const;
+};
+
+#if PRACTICA_METRICS
+
+// Counts one call and its latency in the calling thread's own counters;
+// nothing is shared between threads until the metrics are collected
+void recordOp(Op op, uint64_t nanos, uint64_t bytes, uint64_t records);
+
+// Times its scope as one call of op. I/O operations add the bytes and
+// records they moved with io().
+class OpTimer {
+public:
+    explicit OpTimer(Op op) : op(op), start(chrono::steady_clock::now()) {}
+    ~OpTimer() {
+        auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start);
+        recordOp(op, static_cast<uint64_t>(elapsed.count()), bytes, records);
+    }
+    OpTimer(const OpTimer&) = delete;
+    OpTimer& operator=(const OpTimer&) = delete;
+
+    void io(uint64_t moreBytes, uint64_t moreRecords = 0) {
+        bytes += moreBytes;
+        records += moreRecords;
+    }
+
+private:
+    Op op;
+    chrono::steady_clock::time_point start;
+    uint64_t bytes = 0;
+    uint64_t records = 0;
+};
+
+#else
+
+class OpTimer {
+public:
+    explicit OpTimer(Op) {}
+    void io(uint64_t, uint64_t = 0) {}
+};
+
+#endif
+
+// Every operation called at least once, including by threads that have exited
+vector<OpMetrics> collectMetrics();
+
+// One row per operation, latencies in microseconds
+Table metricsTable(const vector<OpMetrics>& metrics);
+
+// Rewrites path with the metrics (as JSON) every interval, and once more at
+// exit. Does nothing when the metrics are compiled out.
+void startMetricsDump(const string& path, chrono::seconds interval);
+
+#endif // METRICS_H
@@ -0,0 +1,36 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Threads worth using for n items when each thread should get at least
+// minPerThread of them (0 for maxThreads means one per core)
+inline unsigned workerCount(size_t n, size_t minPerThread, unsigned maxThreads = 0) {
+    unsigned cores = maxThreads ? maxThreads : max(1u, thread::hardware_concurrency());
+    size_t worthwhile = max<size_t>(1, n / max<size_t>(1, minPerThread));
+    return static_cast<unsigned>(min<size_t>(cores, worthwhile));
+}
+
+// Splits [0, n) into one contiguous range per worker and calls
+// f(worker, begin, end) for each, on the calling thread plus workers - 1 others
+template <typename F>
+void parallelRanges(size_t n, unsigned workers, F&& f) {
+    workers = max(1u, workers);
+    size_t step = (n + workers - 1) / workers;
+    vector<thread> threads;
+    threads.reserve(workers - 1);
+    for (unsigned w = 1; w < workers; ++w) {
+        size_t begin = min(n, w * step);
+        size_t end = min(n, begin + step);
+        threads.emplace_back([&f, w, begin, end] { f(w, begin, end); });
+    }
+    f(0u, size_t(0), min(n, step));
+    for (auto& t : threads) t.join();
+}
+
+#endif // PARALLEL_H
@@ -0,0 +1,649 @@
+#include "query.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <compare>
+#include <unordered_map>
+#include "journal.h"
+
+static bool isOperatorChar(char c) {
+    return c == '=' || c == '!' || c == '<' || c == '>';
+}
+
+// Words, quoted strings and comparison operators
+static bool tokenize(const string& text, vector<string>& tokens, string& error) {
+    size_t i = 0;
+    while (i < text.size()) {
+        char c = text[i];
+        if (isspace(static_cast<unsigned char>(c))) {
+            i++;
+        } else if (c == '"') {
+            size_t close = text.find('"', i + 1);
+            if (close == string::npos) {
+                error = "unterminated quote";
+                return false;
+            }
+            tokens.push_back(text.substr(i + 1, close - i - 1));
+            i = close + 1;
+        } else if (isOperatorChar(c)) {
+            size_t length = (i + 1 < text.size() && text[i + 1] == '=') ? 2 : 1;
+            tokens.push_back(text.substr(i, length));
+            i += length;
+        } else {
+            size_t start = i;
+            while (i < text.size() && !isspace(static_cast<unsigned char>(text[i])) && !isOperatorChar(text[i]) &&
+                   text[i] != '"') {
+                i++;
+            }
+            tokens.push_back(text.substr(start, i - start));
+        }
+    }
+    return true;
+}
+
+static string lowercase(string s) {
+    for (char& c : s) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+// Values are stored with '_' in place of spaces
+static string encodeValue(string s) {
+    for (char& c : s) {
+        if (c == ' ') c = '_';
+    }
+    return s;
+}
+
+static bool parseOp(const string& token, QueryOp& op) {
+    if (token == "=" || token == "==") op = QueryOp::Equal;
+    else if (token == "!=") op = QueryOp::NotEqual;
+    else if (token == "<") op = QueryOp::Less;
+    else if (token == "<=") op = QueryOp::LessEqual;
+    else if (token == ">") op = QueryOp::Greater;
+    else if (token == ">=") op = QueryOp::GreaterEqual;
+    else return false;
+    return true;
+}
+
+static const char* opText(QueryOp op) {
+    switch (op) {
+        case QueryOp::Equal: return "=";
+        case QueryOp::NotEqual: return "!=";
+        case QueryOp::Less: return "<";
+        case QueryOp::LessEqual: return "<=";
+        case QueryOp::Greater: return ">";
+        case QueryOp::GreaterEqual: return ">=";
+    }
+    return "?";
+}
+
+static bool compare(int64_t left, QueryOp op, int64_t right) {
+    switch (op) {
+        case QueryOp::Equal: return left == right;
+        case QueryOp::NotEqual: return left != right;
+        case QueryOp::Less: return left < right;
+        case QueryOp::LessEqual: return left <= right;
+        case QueryOp::Greater: return left > right;
+        case QueryOp::GreaterEqual: return left >= right;
+    }
+    return false;
+}
+
+static string describe(const QueryPredicate& p) {
+    switch (p.field) {
+        case QueryField::Day: return "day " + string(opText(p.op)) + " " + dayName(static_cast<Day>(p.value));
+        case QueryField::Category:
+            return "category " + string(opText(p.op)) + " " + categoryNames.str(static_cast<uint32_t>(p.value));
+        case QueryField::Channel:
+            return "channel " + string(opText(p.op)) + " " + channelCodes.str(static_cast<uint32_t>(p.value));
+        case QueryField::Duration: return "duration " + string(opText(p.op)) + " " + to_string(p.value);
+        case QueryField::Start:
+            return "start " + string(opText(p.op)) + " " + formatStartTime(static_cast<int>(p.value / 60),
+                                                                        static_cast<int>(p.value % 60));
+    }
+    return "";
+}
+
+class QueryParser {
+public:
+    QueryParser(vector<string> tokens, const Catalog& source, QueryPlan& plan)
+        : tokens(move(tokens)), source(source), plan(plan) {}
+
+    bool parse(string& error);
+
+private:
+    bool atEnd() const { return pos >= tokens.size(); }
+    bool accept(const char* keyword) {
+        if (atEnd() || lowercase(tokens[pos]) != keyword) return false;
+        pos++;
+        return true;
+    }
+    bool expect(const char* keyword, string& error) {
+        if (accept(keyword)) return true;
+        error = string("expected '") + keyword + "'" + (atEnd() ? " at end of query" : " before '" + tokens[pos] + "'");
+        return false;
+    }
+    bool next(string& token, const char* what, string& error) {
+        if (atEnd()) {
+            error = string("expected ") + what + " at end of query";
+            return false;
+        }
+        token = tokens[pos++];
+        return true;
+    }
+
+    bool parseCondition(string& error);
+    void restrictChannels(const vector<uint8_t>& mask);
+
+    vector<string> tokens;
+    size_t pos = 0;
+    const Catalog& source;
+    QueryPlan& plan;
+};
+
+// Keeps only the channel codes allowed by both the current set and mask
+void QueryParser::restrictChannels(const vector<uint8_t>& mask) {
+    if (plan.allowedChannels.empty()) {
+        plan.allowedChannels = mask;
+        return;
+    }
+    for (size_t i = 0; i < plan.allowedChannels.size(); ++i) {
+        plan.allowedChannels[i] &= i < mask.size() ? mask[i] : 0;
+    }
+}
+
+bool QueryParser::parseCondition(string& error) {
+    string field, opToken, value;
+    if (!next(field, "a field", error) || !next(opToken, "an operator", error) || !next(value, "a value", error)) {
+        return false;
+    }
+    field = lowercase(field);
+    QueryOp op;
+    if (!parseOp(opToken, op)) {
+        error = "expected an operator after '" + field + "', got '" + opToken + "'";
+        return false;
+    }
+    bool equality = op == QueryOp::Equal || op == QueryOp::NotEqual;
+
+    if (field == "day") {
+        Day day;
+        if (!parseDay(value, day)) {
+            error = "unknown day '" + value + "'";
+            return false;
+        }
+        plan.residual.push_back({QueryField::Day, op, static_cast<int64_t>(day)});
+    } else if (field == "category") {
+        if (!equality) {
+            error = "category only supports = and !=";
+            return false;
+        }
+        uint32_t id = categoryNames.find(encodeValue(value));
+        if (id == noString) {
+            // Nobody has this category: = matches nothing, != everything
+            if (op == QueryOp::Equal) plan.matchesNothing = true;
+        } else {
+            plan.residual.push_back({QueryField::Category, op, id});
+        }
+    } else if (field == "channel" || field == "country") {
+        if (!equality) {
+            error = field + " only supports = and !=";
+            return false;
+        }
+        // Pushed down: evaluate against the channel table now, leaving a set
+        // of channel codes for the show scan to check
+        vector<uint8_t> mask(channelCodes.size(), op == QueryOp::NotEqual);
+        string wanted = encodeValue(value);
+        if (field == "channel") {
+            uint32_t code = channelCodes.find(wanted);
+            if (code != noString) mask[code] = op == QueryOp::Equal;
+        } else {
+            for (const auto& c : source.channels()) {
+                uint32_t code = channelCodes.find(c.code);
+                if (code != noString && c.originCountry == wanted) mask[code] = op == QueryOp::Equal;
+            }
+        }
+        restrictChannels(mask);
+        plan.notes.push_back("pushed down: " + field + " " + opText(op) + " " + value + " -> channel code set");
+    } else if (field == "duration") {
+        int64_t minutes;
+        auto [end, ec] = from_chars(value.data(), value.data() + value.size(), minutes);
+        if (ec != errc() || end != value.data() + value.size()) {
+            error = "duration needs a number of minutes, got '" + value + "'";
+            return false;
+        }
+        plan.residual.push_back({QueryField::Duration, op, minutes});
+    } else if (field == "start") {
+        // Each part must be a number and nothing else, so "1x:30" is rejected
+        auto whole = [](const char* first, const char* last, int& number) {
+            auto [end, ec] = from_chars(first, last, number);
+            return ec == errc() && end == last;
+        };
+        size_t colon = value.find(':');
+        int hour = -1, minute = -1;
+        bool parsed = colon != string::npos && whole(value.data(), value.data() + colon, hour) &&
+                      whole(value.data() + colon + 1, value.data() + value.size(), minute);
+        if (!parsed || hour < 0 || hour > 23 || minute < 0 || minute > 59) {
+            error = "start needs a time as HH:MM, got '" + value + "'";
+            return false;
+        }
+        plan.residual.push_back({QueryField::Start, op, hour * 60 + minute});
+    } else {
+        error = "unknown field '" + field + "' (use day, category, channel, country, duration or start)";
+        return false;
+    }
+    return true;
+}
+
+bool QueryParser::parse(string& error) {
+    if (!expect("shows", error)) return false;
+
+    if (accept("where")) {
+        do {
+            if (!parseCondition(error)) return false;
+        } while (accept("and"));
+    }
+
+    if (accept("group")) {
+        string field;
+        if (!expect("by", error) || !next(field, "a field to group by", error)) return false;
+        field = lowercase(field);
+        if (field == "day") plan.group = QueryGroup::Day;
+        else if (field == "category") plan.group = QueryGroup::Category;
+        else if (field == "channel") plan.group = QueryGroup::Channel;
+        else if (field == "country") plan.group = QueryGroup::Country;
+        else {
+            error = "cannot group by '" + field + "' (use day, category, channel or country)";
+            return false;
+        }
+    }
+
+    if (accept("order")) {
+        if (!expect("by", error) || !next(plan.orderBy, "a field to order by", error)) return false;
+        plan.orderBy = lowercase(plan.orderBy);
+        static const vector<string> rowKeys = {"name", "category", "start", "duration", "day", "channel"};
+        static const vector<string> groupKeys = {"key", "count", "total", "avg", "min", "max"};
+        const auto& keys = plan.group == QueryGroup::None ? rowKeys : groupKeys;
+        if (ranges::find(keys, plan.orderBy) == keys.end()) {
+            error = "cannot order by '" + plan.orderBy + "'";
+            return false;
+        }
+        if (accept("desc")) {
+            plan.descending = true;
+        } else {
+            accept("asc");
+        }
+    }
+
+    if (accept("limit")) {
+        string count;
+        if (!next(count, "a row count", error)) return false;
+        auto [end, ec] = from_chars(count.data(), count.data() + count.size(), plan.limit);
+        if (ec != errc() || end != count.data() + count.size()) {
+            error = "limit needs a number, got '" + count + "'";
+            return false;
+        }
+    }
+
+    if (!atEnd()) {
+        error = "unexpected '" + tokens[pos] + "'";
+        return false;
+    }
+    return true;
+}
+
+// The column scan and the duration index hand out rows in ShowId order; the
+// day index goes by start time and the channel index channel by channel
+static bool visitsInIdOrder(const QueryPlan& plan) {
+    return plan.access == QueryAccess::ColumnScan || plan.access == QueryAccess::DurationProbe;
+}
+
+// A grouped query that would scan every row anyway, and whose filters are
+// equalities on the day and category or restrict the channels in a way the
+// grouped column kernel can check, runs as one groupedStats pass. The key and
+// filter for that pass are filled in; the channel set is left for the caller
+// to apply per code when the key is the channel.
+static bool columnGrouping(const QueryPlan& plan, ColumnKey& key, ColumnFilter& filter) {
+    if (plan.group == QueryGroup::None || plan.access != QueryAccess::ColumnScan) return false;
+    filter = {};
+    for (const auto& p : plan.residual) {
+        if (p.op != QueryOp::Equal) return false;
+        if (p.field == QueryField::Day && !filter.day) {
+            filter.day = static_cast<uint8_t>(p.value);
+        } else if (p.field == QueryField::Category && !filter.category) {
+            filter.category = static_cast<uint32_t>(p.value);
+        } else {
+            return false;
+        }
+    }
+    switch (plan.group) {
+        case QueryGroup::Day: key = ColumnKey::Day; break;
+        case QueryGroup::Category: key = ColumnKey::Category; break;
+        default: key = ColumnKey::Channel; break;     // countries are rolled up from their channels
+    }
+    if (!plan.allowedChannels.empty() && key != ColumnKey::Channel) {
+        // Other keys can only take a set of one channel, as the filter
+        if (ranges::count(plan.allowedChannels, 1) != 1) return false;
+        filter.channel = static_cast<uint32_t>(ranges::find(plan.allowedChannels, 1) - plan.allowedChannels.begin());
+    }
+    return true;
+}
+
+// Picks the cheapest way to produce candidate rows and removes the predicate
+// it answers from the residual filter
+static void choosePlan(QueryPlan& plan, const Catalog& source) {
+    size_t rows = source.showCount();
+    auto takeEquality = [&plan](QueryField field, int64_t& key) {
+        auto it = ranges::find_if(plan.residual, [field](const QueryPredicate& p) {
+            return p.field == field && p.op == QueryOp::Equal;
+        });
+        if (it == plan.residual.end()) return false;
+        key = it->value;
+        plan.residual.erase(it);
+        return true;
+    };
+
+    int64_t key = 0;
+    auto dayIt = ranges::find_if(plan.residual, [](const QueryPredicate& p) {
+        return p.field == QueryField::Day && p.op == QueryOp::Equal;
+    });
+    auto durationIt = ranges::find_if(plan.residual, [](const QueryPredicate& p) {
+        return p.field == QueryField::Duration && p.op == QueryOp::Equal;
+    });
+    size_t dayRows = dayIt == plan.residual.end() ? rows : source.showsOn(static_cast<Day>(dayIt->value)).size();
+    size_t durationRows = durationIt == plan.residual.end()
+        ? rows : source.durations().withDuration(static_cast<int32_t>(durationIt->value)).size();
+    size_t channelRows = rows;
+    if (!plan.allowedChannels.empty()) {
+        channelRows = 0;
+        for (size_t code = 0; code < plan.allowedChannels.size(); ++code) {
+            if (plan.allowedChannels[code]) channelRows += source.showsOnChannel(static_cast<ChannelCodeId>(code)).size();
+        }
+    }
+    // The day and channel indexes hand out rows one by one, so they only win
+    // while they skip most of the table
+    if (!plan.allowedChannels.empty() && channelRows * 2 <= rows && channelRows < dayRows &&
+        channelRows < durationRows) {
+        plan.access = QueryAccess::ChannelIndex;
+        plan.notes.insert(plan.notes.begin(), "access: channel index (" + to_string(channelRows) + " of " +
+                          to_string(rows) + " rows)");
+    } else if (dayIt != plan.residual.end() && dayRows * 2 <= rows) {
+        takeEquality(QueryField::Day, key);
+        plan.access = QueryAccess::DayIndex;
+        plan.accessKey = key;
+        plan.notes.insert(plan.notes.begin(), "access: day index on " + dayName(static_cast<Day>(key)) + " (" +
+                          to_string(source.showsOn(static_cast<Day>(key)).size()) + " of " + to_string(rows) +
+                          " rows)");
+    } else if (takeEquality(QueryField::Duration, key)) {
+        plan.access = QueryAccess::DurationProbe;
+        plan.accessKey = key;
+        plan.notes.insert(plan.notes.begin(), "access: duration index lookup for " +
+                          to_string(key) + " min");
+    } else {
+        plan.access = QueryAccess::ColumnScan;
+        plan.notes.insert(plan.notes.begin(), "access: full scan of the show columns (" + to_string(rows) + " rows)");
+    }
+
+    for (const auto& p : plan.residual) plan.notes.push_back("filter: " + describe(p));
+    if (plan.matchesNothing) plan.notes.push_back("filter: names a category that does not exist; no rows");
+    ColumnKey columnKey;
+    ColumnFilter filter;
+    if (columnGrouping(plan, columnKey, filter)) {
+        plan.notes.push_back("aggregate: one grouped pass over the columns, filters checked in the loop");
+    }
+    if (plan.group == QueryGroup::Country || plan.group == QueryGroup::Channel) {
+        plan.notes.push_back("join: channel table, after filtering, once per group");
+    }
+    if (plan.group == QueryGroup::None && plan.orderBy.empty() && plan.limit != SIZE_MAX) {
+        plan.notes.push_back(visitsInIdOrder(plan) ? "limit: stops the scan after " + to_string(plan.limit) + " rows"
+                                                   : "limit: keeps the first " + to_string(plan.limit) + " rows by id");
+    } else if (!plan.orderBy.empty()) {
+        plan.notes.push_back(string("order by: ") + plan.orderBy + (plan.descending ? " desc" : ""));
+    }
+}
+
+bool compileQuery(const string& text, const Catalog& source, QueryPlan& plan, string& error) {
+    plan = QueryPlan{};
+    vector<string> tokens;
+    if (!tokenize(text, tokens, error)) return false;
+    QueryParser parser(move(tokens), source, plan);
+    if (!parser.parse(error)) return false;
+    choosePlan(plan, source);
+    return true;
+}
+
+// Group keys are dense IDs; countries get theirs here, from the channel table
+struct GroupKeys {
+    explicit GroupKeys(pmr::memory_resource* memory) : countryOfCode(memory), countries(memory) {}
+
+    pmr::vector<uint32_t> countryOfCode;    // by ChannelCodeId
+    pmr::vector<string_view> countries;     // names in the channel records
+};
+
+static void countryKeys(const Catalog& source, GroupKeys& keys) {
+    keys.countryOfCode.assign(channelCodes.size(), noString);
+    pmr::unordered_map<string_view, uint32_t> ids(keys.countries.get_allocator());
+    for (const auto& c : source.channels()) {
+        uint32_t code = channelCodes.find(c.code);
+        if (code == noString) continue;
+        auto [it, inserted] = ids.try_emplace(c.originCountry, static_cast<uint32_t>(keys.countries.size()));
+        if (inserted) keys.countries.push_back(c.originCountry);
+        keys.countryOfCode[code] = it->second;
+    }
+}
+
+// Runs a grouped query chosen by columnGrouping. Channels and countries are
+// counted per channel code, so the channel set applies to whole codes and
+// countries are the sums of their channels.
+static void groupColumns(const QueryPlan& plan, const Catalog& source, const GroupKeys& keys, ColumnKey key,
+                         const ColumnFilter& filter, pmr::vector<DurationStats>& groups,
+                         pmr::memory_resource* scratch) {
+    const ShowColumns& columns = source.showColumns();
+    auto allowed = [&plan](uint32_t code) {
+        return plan.allowedChannels.empty() || (code < plan.allowedChannels.size() && plan.allowedChannels[code]);
+    };
+    if (plan.group != QueryGroup::Country) {
+        groupedStats(columns, key, filter, groups);
+        for (uint32_t code = 0; plan.group == QueryGroup::Channel && code < groups.size(); ++code) {
+            if (!allowed(code)) groups[code] = {};
+        }
+        return;
+    }
+    pmr::vector<DurationStats> byCode(channelCodes.size(), scratch);
+    groupedStats(columns, key, filter, byCode);
+    for (uint32_t code = 0; code < byCode.size() && code < keys.countryOfCode.size(); ++code) {
+        uint32_t country = keys.countryOfCode[code];
+        if (allowed(code) && country != noString) groups[country].merge(byCode[code]);
+    }
+}
+
+// Orders by the plan's field, then by ShowId, so ties come out the same way
+// with or without a limit and whichever access path found the rows. With no
+// field the rows are just put in ShowId order.
+static void orderRows(pmr::vector<ShowId>& rows, const QueryPlan& plan, const Catalog& source) {
+    auto compareKeys = [&](ShowId a, ShowId b) -> weak_ordering {
+        const show& x = source.getShow(a);
+        const show& y = source.getShow(b);
+        const string& key = plan.orderBy;
+        if (key.empty()) return weak_ordering::equivalent;
+        if (key == "name") return x.name <=> y.name;
+        if (key == "category") return categoryNames.str(x.category) <=> categoryNames.str(y.category);
+        if (key == "duration") return x.duration <=> y.duration;
+        if (key == "day") return x.dayOfWeek <=> y.dayOfWeek;
+        if (key == "channel") return channelCodes.str(x.channelCode) <=> channelCodes.str(y.channelCode);
+        return tuple(x.dayOfWeek, x.startHour, x.startMinute) <=> tuple(y.dayOfWeek, y.startHour, y.startMinute);
+    };
+    auto ordered = [&](ShowId a, ShowId b) {
+        weak_ordering order = compareKeys(a, b);
+        if (order != 0) return plan.descending ? order > 0 : order < 0;
+        return a < b;
+    };
+    if (plan.limit < rows.size()) {
+        partial_sort(rows.begin(), rows.begin() + static_cast<ptrdiff_t>(plan.limit), rows.end(), ordered);
+        rows.resize(plan.limit);
+    } else {
+        sort(rows.begin(), rows.end(), ordered);
+    }
+}
+
+static void orderGroups(pmr::vector<QueryGroupRow>& groups, const QueryPlan& plan) {
+    const string& key = plan.orderBy;
+    if (key.empty() || key == "key") {
+        // Groups are built in key order already (days Monday first, others by name)
+        if (plan.descending) ranges::reverse(groups);
+        return;
+    }
+    auto value = [&key](const QueryGroupRow& g) -> double {
+        if (key == "count") return g.stats.count;
+        if (key == "total") return static_cast<double>(g.stats.sum);
+        if (key == "min") return g.stats.min;
+        if (key == "max") return g.stats.max;
+        return g.stats.average();
+    };
+    ranges::stable_sort(groups, [&](const QueryGroupRow& a, const QueryGroupRow& b) {
+        return plan.descending ? value(a) > value(b) : value(a) < value(b);
+    });
+}
+
+QueryResult runQuery(const QueryPlan& plan, const Catalog& source, pmr::memory_resource* scratch) {
+    QueryResult result(scratch);
+    if (plan.matchesNothing) return result;
+
+    const ShowColumns& columns = source.showColumns();
+    const int32_t* durations = columns.durations();
+    const uint16_t* starts = columns.startMinutes();
+    const uint8_t* days = columns.days();
+    const uint32_t* categories = columns.categories();
+    const uint32_t* codes = columns.channels();
+
+    auto matches = [&](uint32_t id) {
+        if (!plan.allowedChannels.empty() &&
+            (codes[id] >= plan.allowedChannels.size() || !plan.allowedChannels[codes[id]])) {
+            return false;
+        }
+        for (const auto& p : plan.residual) {
+            int64_t value = 0;
+            switch (p.field) {
+                case QueryField::Day: value = days[id]; break;
+                case QueryField::Category: value = categories[id]; break;
+                case QueryField::Channel: value = codes[id]; break;
+                case QueryField::Duration: value = durations[id]; break;
+                case QueryField::Start: value = starts[id]; break;
+            }
+            if (!compare(value, p.op, p.value)) return false;
+        }
+        return true;
+    };
+
+    // Group state: one DurationStats per dense key
+    GroupKeys countries(scratch);
+    if (plan.group == QueryGroup::Country) countryKeys(source, countries);
+    pmr::vector<DurationStats> groupStats(scratch);
+    switch (plan.group) {
+        case QueryGroup::None: break;
+        case QueryGroup::Day: groupStats.resize(daysPerWeek); break;
+        case QueryGroup::Category: groupStats.resize(categoryNames.size()); break;
+        case QueryGroup::Channel: groupStats.resize(channelCodes.size()); break;
+        case QueryGroup::Country: groupStats.resize(countries.countries.size()); break;
+    }
+    // Only a path visiting the rows in ShowId order can stop at the limit;
+    // the others find every row and sort them
+    bool stopEarly = plan.group == QueryGroup::None && plan.orderBy.empty() && visitsInIdOrder(plan);
+
+    // Room for every candidate up front, so the rows take one piece of the
+    // scratch arena instead of a doubling series of them
+    if (plan.group == QueryGroup::None) {
+        size_t candidates = columns.size();
+        if (plan.access == QueryAccess::DayIndex) candidates = source.showsOn(static_cast<Day>(plan.accessKey)).size();
+        if (plan.access == QueryAccess::ChannelIndex) {
+            candidates = 0;
+            for (size_t code = 0; code < plan.allowedChannels.size(); ++code) {
+                if (plan.allowedChannels[code]) candidates += source.showsOnChannel(static_cast<ChannelCodeId>(code)).size();
+            }
+        }
+        if (plan.access == QueryAccess::DurationProbe) {
+            candidates = source.durations().withDuration(static_cast<int32_t>(plan.accessKey)).size();
+        }
+        result.rows.reserve(stopEarly ? min(candidates, plan.limit) : candidates);
+    }
+
+    // Returns false once a limit without ordering has been reached
+    auto visit = [&](uint32_t id) {
+        result.scanned++;
+        if (!matches(id)) return true;
+        uint32_t key = 0;
+        switch (plan.group) {
+            case QueryGroup::None:
+                result.rows.push_back(id);
+                return !(stopEarly && result.rows.size() >= plan.limit);
+            case QueryGroup::Day: key = days[id]; break;
+            case QueryGroup::Category: key = categories[id]; break;
+            case QueryGroup::Channel: key = codes[id]; break;
+            case QueryGroup::Country:
+                key = codes[id] < countries.countryOfCode.size() ? countries.countryOfCode[codes[id]] : noString;
+                if (key == noString) return true;   // show on a channel that no longer exists
+                break;
+        }
+        groupStats[key].add(durations[id]);
+        return true;
+    };
+
+    ColumnKey columnKey;
+    ColumnFilter filter;
+    switch (plan.access) {
+        case QueryAccess::DayIndex:
+            for (ShowId id : source.showsOn(static_cast<Day>(plan.accessKey))) {
+                if (!visit(id)) break;
+            }
+            break;
+        case QueryAccess::ChannelIndex: {
+            bool more = true;
+            for (size_t code = 0; more && code < plan.allowedChannels.size(); ++code) {
+                if (!plan.allowedChannels[code]) continue;
+                for (ShowId id : source.showsOnChannel(static_cast<ChannelCodeId>(code))) {
+                    if (!(more = visit(id))) break;
+                }
+            }
+            break;
+        }
+        case QueryAccess::DurationProbe:
+            for (ShowId id : source.durations().withDuration(static_cast<int32_t>(plan.accessKey))) {
+                if (!visit(id)) break;
+            }
+            break;
+        case QueryAccess::ColumnScan:
+            if (columnGrouping(plan, columnKey, filter)) {
+                groupColumns(plan, source, countries, columnKey, filter, groupStats, scratch);
+                result.scanned = source.showCount();
+                break;
+            }
+            for (uint32_t id = 0; id < columns.size(); ++id) {
+                if (categories[id] != ShowColumns::deadRow && !visit(id)) break;
+            }
+            break;
+    }
+
+    if (plan.group == QueryGroup::None) {
+        if (!plan.orderBy.empty() || !visitsInIdOrder(plan)) orderRows(result.rows, plan, source);
+        if (result.rows.size() > plan.limit) result.rows.resize(plan.limit);
+        return result;
+    }
+
+    for (uint32_t key = 0; key < groupStats.size(); ++key) {
+        if (groupStats[key].count == 0) continue;
+        string_view label;
+        switch (plan.group) {
+            case QueryGroup::Day: label = dayName(static_cast<Day>(key)); break;
+            case QueryGroup::Category: label = categoryNames.str(key); break;
+            case QueryGroup::Channel: label = channelCodes.str(key); break;
+            case QueryGroup::Country: label = countries.countries[key]; break;
+            case QueryGroup::None: break;
+        }
+        result.groups.push_back({label, groupStats[key]});
+    }
+    if (plan.group != QueryGroup::Day) {
+        ranges::sort(result.groups, [](const QueryGroupRow& a, const QueryGroupRow& b) { return a.key < b.key; });
+    }
+    orderGroups(result.groups, plan);
+    if (result.groups.size() > plan.limit) result.groups.resize(plan.limit);
+    return result;
+}
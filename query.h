@@ -0,0 +1,78 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "catalog.h"
+
+using namespace std;
+
+// A small query language over the show and channel tables:
+//
+//   shows [where COND {and COND}] [group by day|category|channel|country]
+//         [order by FIELD [asc|desc]] [limit N]
+//
+//   COND   day = Luni | category = Film | channel = 4 | country = Romania
+//          duration OP N | start OP HH:MM        (OP: = != < <= > >=)
+//
+// Rows are ordered by name, category, start, duration, day or channel, ties
+// and unordered rows by ShowId whichever access path found them; groups by
+// key, count, total, avg, min or max. Quote values with spaces.
+//
+// compileQuery resolves names to IDs and picks an access path: the per-day
+// schedule index, the shows of the allowed channels, the ordered duration
+// index, or a full column scan. Channel and country filters are pushed down to
+// the channel table first and become a set of allowed channel codes, so shows
+// are only joined to channels for the groups that survive.
+
+enum class QueryField : uint8_t { Day, Category, Channel, Duration, Start };
+enum class QueryOp : uint8_t { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual };
+enum class QueryGroup : uint8_t { None, Day, Category, Channel, Country };
+enum class QueryAccess : uint8_t { DayIndex, ChannelIndex, DurationProbe, ColumnScan };
+
+struct QueryPredicate {
+    QueryField field;
+    QueryOp op;
+    int64_t value;      // day number, interned ID, minutes or minute of day
+};
+
+struct QueryPlan {
+    QueryAccess access = QueryAccess::ColumnScan;
+    int64_t accessKey = 0;                  // the day or duration the access path looks up
+    vector<QueryPredicate> residual;        // checked against the columns of each candidate
+    vector<uint8_t> allowedChannels;        // by ChannelCodeId; empty when unrestricted
+    bool matchesNothing = false;            // a filter named something that does not exist
+
+    QueryGroup group = QueryGroup::None;
+    string orderBy;                         // empty for ShowId order
+    bool descending = false;
+    size_t limit = SIZE_MAX;
+
+    vector<string> notes;                   // how the plan was chosen, for explain
+};
+
+struct QueryGroupRow {
+    string_view key;                        // an interned name or a channel's country
+    DurationStats stats;
+};
+
+// Refers into the catalog it was run on, which must outlive it
+struct QueryResult {
+    explicit QueryResult(pmr::memory_resource* memory = pmr::get_default_resource()) : rows(memory), groups(memory) {}
+
+    pmr::vector<ShowId> rows;               // when the query has no group by
+    pmr::vector<QueryGroupRow> groups;
+    size_t scanned = 0;                     // candidates the access path produced
+};
+
+bool compileQuery(const string& text, const Catalog& source, QueryPlan& plan, string& error);
+
+// The rows and every temporary of the run are allocated from scratch, such
+// as a ScratchScope's arena, which must outlive the result
+QueryResult runQuery(const QueryPlan& plan, const Catalog& source,
+                     pmr::memory_resource* scratch = pmr::get_default_resource());
+
+#endif // QUERY_H
@@ -0,0 +1,42 @@
+#include "schedule.h"
+#include <algorithm>
+#include "catalog.h"
+#include "cow.h"
+
+DaySchedule::DaySchedule() {
+    for (auto& day : days) day = make_shared<DayBuckets>(minutesPerDay);
+}
+
+vector<uint32_t>& DaySchedule::bucketFor(const show& s) {
+    size_t minute = static_cast<size_t>(s.startHour) * 60 + s.startMinute;
+    return unshare(days[static_cast<int>(s.dayOfWeek)])[min<size_t>(minute, minutesPerDay - 1)];
+}
+
+void DaySchedule::add(uint32_t id, const show& s) {
+    vector<uint32_t>& bucket = bucketFor(s);
+    // IDs are handed out in increasing order, so this is almost always an append
+    bucket.insert(upper_bound(bucket.begin(), bucket.end(), id), id);
+    counts[static_cast<int>(s.dayOfWeek)]++;
+}
+
+void DaySchedule::remove(uint32_t id, const show& s) {
+    vector<uint32_t>& bucket = bucketFor(s);
+    auto it = lower_bound(bucket.begin(), bucket.end(), id);
+    if (it == bucket.end() || *it != id) return;
+    bucket.erase(it);
+    counts[static_cast<int>(s.dayOfWeek)]--;
+}
+
+void DaySchedule::remap(const vector<uint32_t>& newIds) {
+    // Compaction keeps the relative order of IDs, so buckets stay sorted
+    for (auto& day : days) {
+        for (auto& bucket : unshare(day)) {
+            for (auto& id : bucket) id = newIds[id];
+        }
+    }
+}
+
+DaySchedule::Range DaySchedule::on(Day day) const {
+    const vector<uint32_t>* first = days[static_cast<int>(day)]->data();
+    return {first, first + minutesPerDay, counts[static_cast<int>(day)]};
+}
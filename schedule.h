@@ -0,0 +1,77 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "intern.h"
+
+using namespace std;
+
+struct show;
+
+constexpr int minutesPerDay = 24 * 60;
+
+// Show IDs bucketed by day and start minute. Each bucket keeps its IDs in
+// ascending order, so walking a day's buckets yields its shows sorted by start
+// time (ties in insertion order) without copying or sorting anything. Inserts
+// and erases only touch one small bucket, which keeps bulk loads cheap. Each
+// day's buckets are copy-on-write, so a copy of the schedule shares the days
+// neither side has changed.
+class DaySchedule {
+public:
+    class iterator {
+    public:
+        iterator(const vector<uint32_t>* bucket, const vector<uint32_t>* last)
+            : bucket(bucket), last(last) { skipEmpty(); }
+        uint32_t operator*() const { return (*bucket)[pos]; }
+        iterator& operator++() {
+            if (++pos == bucket->size()) { ++bucket; pos = 0; skipEmpty(); }
+            return *this;
+        }
+        bool operator==(const iterator& other) const { return bucket == other.bucket && pos == other.pos; }
+
+    private:
+        void skipEmpty() {
+            while (bucket != last && bucket->empty()) ++bucket;
+        }
+
+        const vector<uint32_t>* bucket;
+        const vector<uint32_t>* last;
+        size_t pos = 0;
+    };
+
+    // The shows of one day, in start time order
+    class Range {
+    public:
+        Range(const vector<uint32_t>* first, const vector<uint32_t>* last, size_t count)
+            : first(first), last(last), count(count) {}
+        iterator begin() const { return {first, last}; }
+        iterator end() const { return {last, last}; }
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+
+    private:
+        const vector<uint32_t>* first;
+        const vector<uint32_t>* last;
+        size_t count;
+    };
+
+    DaySchedule();
+
+    void add(uint32_t id, const show& s);
+    void remove(uint32_t id, const show& s);
+    void remap(const vector<uint32_t>& newIds);     // after Catalog compaction
+
+    Range on(Day day) const;
+
+private:
+    using DayBuckets = vector<vector<uint32_t>>;      // minutesPerDay buckets
+
+    vector<uint32_t>& bucketFor(const show& s);
+
+    shared_ptr<DayBuckets> days[daysPerWeek];
+    size_t counts[daysPerWeek] = {};
+};
+
+#endif // SCHEDULE_H
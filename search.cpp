@@ -0,0 +1,409 @@
+#include "search.h"
+#include <algorithm>
+#include "cow.h"
+
+static const char* const matchKindNames[] = {"exact", "prefix", "word", "substring", "typo"};
+
+const char* matchKindName(MatchKind kind) {
+    return matchKindNames[static_cast<size_t>(kind)];
+}
+
+static char lower(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+string normalizeSearch(string_view text) {
+    size_t first = text.find_first_not_of(' ');
+    if (first == string_view::npos) return {};
+    text = text.substr(first, text.find_last_not_of(' ') - first + 1);
+    string normalized(text);
+    for (char& c : normalized) c = c == ' ' ? '_' : lower(c);
+    return normalized;
+}
+
+int maxTypos(string_view query) {
+    return query.size() >= 8 ? 2 : query.size() >= 4 ? 1 : 0;
+}
+
+// Whether name has the query at pos, ignoring case
+static bool occursAt(string_view query, string_view name, size_t pos) {
+    if (pos + query.size() > name.size()) return false;
+    for (size_t i = 0; i < query.size(); ++i) {
+        if (lower(name[pos + i]) != query[i]) return false;
+    }
+    return true;
+}
+
+// Typo matching keeps a query's positions in one 64-bit word
+static constexpr size_t longestTypoQuery = 64;
+
+// Fewest edits turning the query into some substring of name: Sellers' edit
+// distance with a free start and end in name, a column at a time as bit
+// vectors (Myers' algorithm)
+static int substringDistance(string_view query, string_view name) {
+    // Which query positions hold each character; kept for the next call,
+    // which usually has the same query
+    thread_local string cached;
+    thread_local uint64_t positions[256];
+    if (query != cached) {
+        for (char c : cached) positions[static_cast<unsigned char>(c)] = 0;
+        cached = query;
+        for (size_t i = 0; i < query.size(); ++i) positions[static_cast<unsigned char>(query[i])] |= uint64_t(1) << i;
+    }
+
+    // Vertical deltas between adjacent rows of the current column, +1 or -1
+    uint64_t plus = ~uint64_t(0), minus = 0;
+    const uint64_t last = uint64_t(1) << (query.size() - 1);
+    int distance = static_cast<int>(query.size());
+    int best = distance;
+    for (char c : name) {
+        uint64_t equal = positions[static_cast<unsigned char>(lower(c))];
+        uint64_t vertical = equal | minus;
+        uint64_t horizontal = (((equal & plus) + plus) ^ plus) | equal;
+        uint64_t up = minus | ~(horizontal | plus);
+        uint64_t down = plus & horizontal;
+        if (up & last) {
+            distance++;
+        } else if (down & last) {
+            distance--;
+        }
+        // The top row stays 0: a match may start anywhere in name
+        up <<= 1;
+        down <<= 1;
+        plus = down | ~(vertical | up);
+        minus = up & vertical;
+        best = min(best, distance);
+    }
+    return best;
+}
+
+bool matchName(string_view query, string_view name, MatchKind& kind, int& typos) {
+    typos = 0;
+    if (query.empty()) return false;
+    if (occursAt(query, name, 0)) {
+        kind = name.size() == query.size() ? MatchKind::Exact : MatchKind::Prefix;
+        return true;
+    }
+    bool inside = false;
+    for (size_t pos = 1; pos + query.size() <= name.size(); ++pos) {
+        if (!occursAt(query, name, pos)) continue;
+        if (name[pos - 1] == '_') {
+            kind = MatchKind::WordPrefix;
+            return true;
+        }
+        inside = true;
+    }
+    if (inside && query.size() > 1) {
+        kind = MatchKind::Substring;
+        return true;
+    }
+    int allowed = maxTypos(query);
+    if (allowed == 0 || query.size() > longestTypoQuery) return false;
+    typos = substringDistance(query, name);
+    kind = MatchKind::Typo;
+    return typos <= allowed;
+}
+
+void PostingList::insert(uint32_t id) {
+    // IDs are handed out in increasing order, so this is almost always an append
+    if (chunks.empty() || id > lasts.back()) {
+        if (chunks.empty() || chunks.back()->size() >= chunkSize) {
+            chunks.push_back(make_shared<vector<uint32_t>>());
+            lasts.push_back(id);
+        }
+        unshare(chunks.back()).push_back(id);
+        lasts.back() = id;
+        count++;
+        return;
+    }
+    size_t c = static_cast<size_t>(ranges::lower_bound(lasts, id) - lasts.begin());
+    auto at = ranges::lower_bound(*chunks[c], id);
+    if (*at == id) return;
+    auto offset = at - chunks[c]->begin();
+    vector<uint32_t>& chunk = unshare(chunks[c]);
+    chunk.insert(chunk.begin() + offset, id);
+    count++;
+    if (chunk.size() > chunkSize) {
+        auto half = chunk.begin() + chunkSize / 2;
+        chunks.insert(chunks.begin() + static_cast<ptrdiff_t>(c) + 1, make_shared<vector<uint32_t>>(half, chunk.end()));
+        chunk.erase(half, chunk.end());
+        lasts.insert(lasts.begin() + static_cast<ptrdiff_t>(c), chunk.back());
+    }
+}
+
+void PostingList::erase(uint32_t id) {
+    size_t c = static_cast<size_t>(ranges::lower_bound(lasts, id) - lasts.begin());
+    if (c == lasts.size()) return;
+    auto at = ranges::lower_bound(*chunks[c], id);
+    if (*at != id) return;
+    auto offset = at - chunks[c]->begin();
+    vector<uint32_t>& chunk = unshare(chunks[c]);
+    chunk.erase(chunk.begin() + offset);
+    count--;
+    if (chunk.empty()) {
+        chunks.erase(chunks.begin() + static_cast<ptrdiff_t>(c));
+        lasts.erase(lasts.begin() + static_cast<ptrdiff_t>(c));
+    } else {
+        lasts[c] = chunk.back();
+    }
+}
+
+void PostingList::remap(const vector<uint32_t>& newIds) {
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        vector<uint32_t>& chunk = unshare(chunks[c]);
+        for (uint32_t& id : chunk) id = newIds[id];
+        lasts[c] = chunk.back();
+    }
+}
+
+void PostingList::Cursor::next() {
+    if (++pos == list->chunks[chunk]->size()) {
+        ++chunk;
+        pos = 0;
+    }
+}
+
+void PostingList::Cursor::seek(uint32_t target) {
+    if (done() || id() >= target) return;
+    if (target > list->lasts[chunk]) {
+        auto next = lower_bound(list->lasts.begin() + static_cast<ptrdiff_t>(chunk) + 1, list->lasts.end(), target);
+        chunk = static_cast<size_t>(next - list->lasts.begin());
+        pos = 0;
+        if (done()) return;
+    }
+    const vector<uint32_t>& ids = *list->chunks[chunk];
+    pos = static_cast<size_t>(lower_bound(ids.begin() + static_cast<ptrdiff_t>(pos), ids.end(), target) - ids.begin());
+}
+
+// Characters fold to 6-bit codes: letters without case, digits, '_', and
+// every other byte into one of 26 shared codes. 0 marks the start and end.
+static uint32_t fold(char c) {
+    auto byte = static_cast<unsigned char>(c);
+    if (byte >= 'a' && byte <= 'z') return byte - 'a' + 1u;
+    if (byte >= 'A' && byte <= 'Z') return byte - 'A' + 1u;
+    if (byte >= '0' && byte <= '9') return byte - '0' + 27u;
+    if (byte == '_') return 37;
+    return 38 + byte % 26u;
+}
+
+static constexpr uint32_t marker = 0;
+static constexpr size_t shardCount = 1 << 12;
+
+// The trigrams of text, each three codes in 18 bits, with the text after two
+// start markers and before an end marker as asked
+static void trigramsOf(string_view text, bool start, bool end, vector<uint32_t>& out) {
+    out.clear();
+    uint32_t window = 0;
+    size_t seen = 0;
+    auto push = [&](uint32_t code) {
+        window = ((window << 6) | code) & 0x3FFFF;
+        if (++seen >= 3) out.push_back(window);
+    };
+    if (start) {
+        push(marker);
+        push(marker);
+    }
+    for (char c : text) push(fold(c));
+    if (end) push(marker);
+    ranges::sort(out);
+    out.erase(unique(out.begin(), out.end()), out.end());
+}
+
+NameIndex::NameIndex() : shards(shardCount) {}
+
+const PostingList* NameIndex::list(uint32_t trigram) const {
+    const auto& shard = shards[trigram >> 6];
+    return shard ? shard->lists[trigram & 63].get() : nullptr;
+}
+
+void NameIndex::add(uint32_t id, string_view name) {
+    change(id, name, true);
+}
+
+void NameIndex::remove(uint32_t id, string_view name) {
+    change(id, name, false);
+}
+
+void NameIndex::change(uint32_t id, string_view name, bool adding) {
+    thread_local vector<uint32_t> trigrams;
+    trigramsOf(name, true, true, trigrams);
+    for (uint32_t trigram : trigrams) {
+        auto& shard = shards[trigram >> 6];
+        if (adding) {
+            unshare(unshare(shard).lists[trigram & 63]).insert(id);
+        } else if (list(trigram)) {
+            auto& slot = unshare(shard).lists[trigram & 63];
+            unshare(slot).erase(id);
+            if (slot->size() == 0) slot.reset();
+        }
+    }
+}
+
+void NameIndex::remap(const vector<uint32_t>& newIds) {
+    for (auto& shard : shards) {
+        if (!shard) continue;
+        for (auto& slot : unshare(shard).lists) {
+            if (slot) unshare(slot).remap(newIds);
+        }
+    }
+}
+
+// The IDs in every one of some posting lists, or in any of them, in ascending
+// order. In the first case the shortest list leads and the others skip ahead
+// to its IDs. Each step taken comes out of the search's budget; the stream
+// ends early once that is spent.
+class NameIndex::IdStream {
+public:
+    IdStream(vector<const PostingList*> lists, bool every, size_t& budget) : every(every), budget(&budget) {
+        if (every) ranges::sort(lists, {}, &PostingList::size);
+        for (const PostingList* list : lists) cursors.emplace_back(*list);
+        settle();
+    }
+
+    bool done() const { return finished; }
+    uint32_t id() const { return current; }
+
+    void next() {
+        if (every) {
+            cursors[0].next();
+        } else {
+            for (auto& cursor : cursors) {
+                if (!cursor.done() && cursor.id() == current) cursor.next();
+            }
+        }
+        settle();
+    }
+
+private:
+    void settle() {
+        finished = true;
+        if (*budget == 0) return;
+        --*budget;
+        if (!every) {
+            for (const auto& cursor : cursors) {
+                if (cursor.done()) continue;
+                current = finished ? cursor.id() : min(current, cursor.id());
+                finished = false;
+            }
+            return;
+        }
+        PostingList::Cursor& lead = cursors[0];
+        while (!lead.done()) {
+            uint32_t candidate = lead.id();
+            uint32_t ahead = candidate;
+            for (size_t i = 1; i < cursors.size() && ahead == candidate; ++i) {
+                cursors[i].seek(candidate);
+                if (cursors[i].done()) return;
+                ahead = cursors[i].id();
+            }
+            if (ahead == candidate) {
+                current = candidate;
+                finished = false;
+                return;
+            }
+            if (*budget == 0) return;
+            --*budget;
+            lead.seek(ahead);
+        }
+    }
+
+    vector<PostingList::Cursor> cursors;
+    bool every;
+    size_t* budget;
+    bool finished = true;
+    uint32_t current = 0;
+};
+
+// The IDs whose names contain the text, or might: those with all of its
+// trigrams, or for two characters without markers, those with a trigram
+// starting with both. False if there can be none.
+bool NameIndex::containing(string_view text, bool start, bool end, size_t& budget, vector<IdStream>& out) const {
+    vector<uint32_t> trigrams;
+    trigramsOf(text, start, end, trigrams);
+    vector<const PostingList*> found;
+    if (!trigrams.empty()) {
+        for (uint32_t trigram : trigrams) {
+            const PostingList* l = list(trigram);
+            if (!l) return false;
+            found.push_back(l);
+        }
+        out.emplace_back(move(found), true, budget);
+        return true;
+    }
+    if (text.size() != 2 || start || end) return false;
+    const auto& shard = shards[fold(text[0]) << 6 | fold(text[1])];
+    if (!shard) return false;
+    for (const auto& l : shard->lists) {
+        if (l) found.push_back(l.get());
+    }
+    out.emplace_back(move(found), false, budget);
+    return true;
+}
+
+void NameIndex::search(string_view query, size_t limit, const function<string_view(uint32_t)>& nameOf,
+                       vector<Match>& out) const {
+    if (query.empty() || limit == 0) return;
+    size_t wanted = out.size() + limit;
+
+    // Keeps the candidates that match by exactly this tier; better matches
+    // were found by an earlier tier
+    auto keep = [&](MatchKind tier, int allowed) {
+        return [&, tier, allowed](uint32_t id) {
+            MatchKind kind;
+            int typos;
+            if (matchName(query, nameOf(id), kind, typos) && kind == tier && typos == allowed) {
+                out.push_back({id, kind, static_cast<uint8_t>(typos)});
+            }
+            return out.size() < wanted;
+        };
+    };
+
+    string word = "_" + string(query);
+    const struct {
+        MatchKind kind;
+        string_view text;
+        bool start, end;
+    } tiers[] = {
+        {MatchKind::Exact, query, true, true},
+        {MatchKind::Prefix, query, true, false},
+        {MatchKind::WordPrefix, word, false, false},
+        {MatchKind::Substring, query, false, false},
+    };
+    // Visits each ID in any of the streams, in ascending order, until the
+    // limit is reached or the budget spent
+    size_t budget = workBudget;
+    vector<IdStream> streams;
+    auto walk = [&](auto&& visit) {
+        while (budget > 0) {
+            --budget;
+            uint32_t candidate = UINT32_MAX;
+            for (const auto& stream : streams) {
+                if (!stream.done()) candidate = min(candidate, stream.id());
+            }
+            if (candidate == UINT32_MAX || !visit(candidate)) return;
+            for (auto& stream : streams) {
+                if (!stream.done() && stream.id() == candidate) stream.next();
+            }
+        }
+    };
+
+    for (const auto& tier : tiers) {
+        streams.clear();
+        if (!containing(tier.text, tier.start, tier.end, budget, streams)) continue;
+        walk(keep(tier.kind, 0));
+        if (out.size() >= wanted) return;
+    }
+
+    // With k typos the query splits into k + 1 pieces of which at least one
+    // is left intact, so a candidate contains one of them
+    for (int typos = 1; typos <= maxTypos(query); ++typos) {
+        streams.clear();
+        size_t pieces = static_cast<size_t>(typos) + 1;
+        for (size_t p = 0; p < pieces; ++p) {
+            size_t from = p * query.size() / pieces, to = (p + 1) * query.size() / pieces;
+            containing(query.substr(from, to - from), false, false, budget, streams);
+        }
+        walk(keep(MatchKind::Typo, typos));
+        if (out.size() >= wanted) return;
+    }
+}
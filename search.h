@@ -0,0 +1,150 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// How a name matched a search, best first
+enum class MatchKind : uint8_t {
+    Exact,
+    Prefix,
+    WordPrefix,     // at the start of a later word: "sea" in "Film_de_seara"
+    Substring,
+    Typo            // a substring within a few edits of the query
+};
+
+const char* matchKindName(MatchKind kind);
+
+// Search text the way names are matched: ASCII letters lowercased and spaces
+// as '_', as names are stored
+string normalizeSearch(string_view text);
+
+// Edits a typo match may differ by: none below 4 characters, then 1, and 2
+// from 8 characters on
+int maxTypos(string_view query);
+
+// The best way name matches a normalized query, if any. Letters compare
+// without regard to case; a single character matches only at the start of a
+// word.
+bool matchName(string_view query, string_view name, MatchKind& kind, int& typos);
+
+// Sorted IDs in copy-on-write chunks, so a copy shares every chunk neither
+// side has changed and an insert or erase copies at most one of them
+class PostingList {
+public:
+    size_t size() const { return count; }
+    void insert(uint32_t id);
+    void erase(uint32_t id);
+    void remap(const vector<uint32_t>& newIds);     // renumbering that keeps the order
+
+    // The IDs in ascending order
+    class iterator {
+    public:
+        iterator(const PostingList* list, size_t chunk) : list(list), chunk(chunk) {}
+        uint32_t operator*() const { return (*list->chunks[chunk])[pos]; }
+        iterator& operator++() {
+            if (++pos == list->chunks[chunk]->size()) { ++chunk; pos = 0; }
+            return *this;
+        }
+        bool operator==(const iterator& other) const { return chunk == other.chunk && pos == other.pos; }
+
+    private:
+        const PostingList* list;
+        size_t chunk;
+        size_t pos = 0;
+    };
+
+    iterator begin() const { return {this, 0}; }
+    iterator end() const { return {this, chunks.size()}; }
+
+    // Walks the IDs in ascending order, skipping ahead on request
+    class Cursor {
+    public:
+        explicit Cursor(const PostingList& list) : list(&list) {}
+        bool done() const { return chunk == list->chunks.size(); }
+        uint32_t id() const { return (*list->chunks[chunk])[pos]; }
+        void next();
+        void seek(uint32_t id);     // to the first ID >= id
+
+    private:
+        const PostingList* list;
+        size_t chunk = 0;
+        size_t pos = 0;
+    };
+
+private:
+    static constexpr size_t chunkSize = 1024;
+
+    vector<shared_ptr<vector<uint32_t>>> chunks;    // never empty
+    vector<uint32_t> lasts;                         // last ID of each chunk
+    size_t count = 0;
+};
+
+// Trigram index over the names of one table, for prefix, substring and
+// typo-tolerant search. A name is indexed by the trigrams of its text
+// between a start and an end marker, case folded, so the trigrams of a
+// query also pin where a match starts or ends:
+//
+//   "fo" as a prefix    ^^f ^fo
+//   "fo" exactly        ^^f ^fo fo$
+//   "otba" anywhere     otb tba
+//
+// Matches are gathered a tier at a time (exact, prefix, word prefix,
+// substring, then typos) by walking the intersection of the query's posting
+// lists in ID order and checking each candidate's actual name, stopping once
+// the limit is reached, so a query matching half the table costs no more
+// than a rare one. Within a tier matches come in ID order. Two characters
+// have no trigram of their own; they are found through the trigrams that
+// start with them, so only a single character cannot match mid-word.
+//
+// A name within k typos of the query contains one of k + 1 pieces the query
+// splits into intact, so typo candidates are those containing any piece.
+//
+// A search gives up after workBudget steps, each a candidate checked or a
+// skip while intersecting lists, so one that matches little in a huge table
+// stays cheap; it may then miss some of the rarer matches.
+//
+// Posting lists and the shards holding them are copy-on-write, like the
+// catalog's other indexes.
+class NameIndex {
+public:
+    static constexpr size_t workBudget = 1 << 13;
+
+    struct Match {
+        uint32_t id;
+        MatchKind kind;
+        uint8_t typos;
+    };
+
+    NameIndex();
+
+    void add(uint32_t id, string_view name);
+    void remove(uint32_t id, string_view name);
+    void remap(const vector<uint32_t>& newIds);     // after compaction; erased IDs were removed already
+
+    // Appends up to limit matches of a normalized query. nameOf gives the
+    // current name of an indexed ID.
+    void search(string_view query, size_t limit, const function<string_view(uint32_t)>& nameOf,
+                vector<Match>& out) const;
+
+private:
+    struct Shard {
+        shared_ptr<PostingList> lists[64];      // by the trigram's last character; null while empty
+    };
+
+    class IdStream;
+
+    const PostingList* list(uint32_t trigram) const;
+    void change(uint32_t id, string_view name, bool adding);
+    bool containing(string_view text, bool start, bool end, size_t& budget, vector<IdStream>& out) const;
+
+    vector<shared_ptr<Shard>> shards;       // by the trigram's first two characters
+};
+
+#endif // SEARCH_H
@@ -0,0 +1,786 @@
+#include "server.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include "arena.h"
+#include "batch.h"
+#include "cli.h"
+#include "metrics.h"
+#include "query.h"
+#include "versions.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Set by SIGINT/SIGTERM, read by every connection thread
+static atomic<bool> stopRequested {false};
+static_assert(atomic<bool>::is_always_lock_free, "the stop flag is set from a signal handler");
+
+static void requestStop(int) {
+    stopRequested = true;
+}
+
+// How often threads blocked on a socket wake up to check for shutdown
+constexpr int pollMillis = 200;
+
+// Rows a shows/channels request returns when it gives no limit
+constexpr size_t defaultRows = 100;
+
+// Matches a search request returns
+constexpr size_t searchRows = 20;
+
+static bool isTcp(const string& address) {
+    return address.starts_with("tcp:");
+}
+
+// Binds and listens on, or connects to, a Unix socket path or tcp:PORT on
+// the loopback interface
+static int openSocket(const string& address, bool listening, string& error) {
+    int fd = -1;
+    int rc = -1;
+    if (isTcp(address)) {
+        int port = atoi(address.c_str() + 4);
+        if (port <= 0 || port > 65535) {
+            error = "invalid port";
+            return -1;
+        }
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            error = strerror(errno);
+            return -1;
+        }
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int one = 1;
+        if (listening) {
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+            rc = ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr);
+        } else {
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+            rc = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr);
+        }
+    } else {
+        sockaddr_un addr {};
+        if (address.empty() || address.size() >= sizeof addr.sun_path) {
+            error = "socket path is empty or too long";
+            return -1;
+        }
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            error = strerror(errno);
+            return -1;
+        }
+        addr.sun_family = AF_UNIX;
+        memcpy(addr.sun_path, address.c_str(), address.size() + 1);
+        if (listening) {
+            ::unlink(address.c_str());      // left behind by a server that did not shut down
+            rc = ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr);
+        } else {
+            rc = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr);
+        }
+    }
+    if (rc < 0 || (listening && ::listen(fd, SOMAXCONN) < 0)) {
+        error = strerror(errno);
+        ::close(fd);
+        return -1;
+    }
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return fd;
+}
+
+// Buffered line I/O over one socket
+class Connection {
+public:
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection() {
+        if (fd >= 0) ::close(fd);
+    }
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    bool valid() const { return fd >= 0; }
+
+    // The next line without its '\n'. False on end of stream, on an error,
+    // or, when stoppable, once the server has been asked to stop.
+    bool readLine(string& line, bool stoppable) {
+        while (true) {
+            size_t nl = buffer.find('\n', start);
+            if (nl != string::npos) {
+                line.assign(buffer, start, nl - start);
+                start = nl + 1;
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                return true;
+            }
+            if (buffer.size() - start > maxLine || !fill(stoppable)) return false;
+        }
+    }
+
+    bool readExactly(size_t n, string& out) {
+        while (buffer.size() - start < n) {
+            if (!fill(false)) return false;
+        }
+        out.assign(buffer, start, n);
+        start += n;
+        return true;
+    }
+
+    bool send(string_view data) {
+        while (!data.empty()) {
+            ssize_t sent = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data.remove_prefix(static_cast<size_t>(sent));
+        }
+        return true;
+    }
+
+private:
+    static constexpr size_t maxLine = 1 << 20;
+
+    bool fill(bool stoppable) {
+        if (start > 0 && start == buffer.size()) {
+            buffer.clear();
+            start = 0;
+        } else if (start > 65536) {
+            buffer.erase(0, start);
+            start = 0;
+        }
+        while (stoppable) {
+            if (stopRequested) return false;
+            pollfd p {fd, POLLIN, 0};
+            int ready = ::poll(&p, 1, pollMillis);
+            if (ready > 0) break;
+            if (ready < 0 && errno != EINTR) return false;
+        }
+        char chunk[65536];
+        while (true) {
+            ssize_t got = ::recv(fd, chunk, sizeof chunk, 0);
+            if (got > 0) {
+                buffer.append(chunk, static_cast<size_t>(got));
+                return true;
+            }
+            if (got < 0 && errno == EINTR) continue;
+            return false;
+        }
+    }
+
+    int fd;
+    string buffer;
+    size_t start = 0;
+};
+
+static string ok(const string& body) {
+    return "OK " + to_string(body.size()) + "\n" + body;
+}
+
+static string err(const string& message) {
+    return "ERR " + message + "\n";
+}
+
+// Names are stored with '_' in place of spaces
+static string stored(string s) {
+    for (char& c : s) {
+        if (c == ' ') c = '_';
+    }
+    return s;
+}
+
+// "-" keeps the current value of a field in edit commands
+static string keepOr(const string& arg, const string& current) {
+    return arg == "-" ? current : stored(arg);
+}
+
+static bool parseCount(const string& text, size_t& value) {
+    try {
+        size_t used = 0;
+        long long parsed = stoll(text, &used);
+        if (used != text.size() || parsed < 0) return false;
+        value = static_cast<size_t>(parsed);
+        return true;
+    } catch (const exception&) {
+        return false;
+    }
+}
+
+static bool isWrite(const string& command) {
+    return command == "add-show" || command == "edit-show" || command == "delete-show" ||
+           command == "add-channel" || command == "edit-channel" || command == "delete-channel";
+}
+
+class Server {
+public:
+    Server(const Catalog& initial, Journal& journal) : versions(initial), journal(journal) {}
+
+    shared_ptr<const Catalog> snapshot() const { return versions.pin(); }
+    string handle(const string& line);
+    void writerLoop();
+    void stop();
+
+private:
+    struct Request {
+        vector<string> words;
+        string reply;
+        bool done = false;
+    };
+
+    string read(const vector<string>& words, const string& line, const Catalog& source) const;
+    string write(vector<string> words);
+    string apply(const vector<string>& words, Catalog& next, bool& changed);
+
+    CatalogVersions versions;
+    Journal& journal;
+
+    mutex lock;
+    condition_variable queued;      // the writer waits for requests
+    condition_variable answered;    // clients wait for their replies
+    vector<Request*> queue;
+    bool stopping = false;
+};
+
+string Server::handle(const string& line) {
+    vector<string> words = splitCommandLine(line);
+    if (words.empty()) return err("empty request");
+    if (isWrite(words[0])) {
+        OpTimer timer(Op::ServerWrite);     // queueing, the group's fsync and publishing
+        return write(move(words));
+    }
+    OpTimer timer(Op::ServerRead);
+    // One atomic load; the version stays alive for as long as this request uses it
+    shared_ptr<const Catalog> source = versions.pin();
+    return read(words, line, *source);
+}
+
+string Server::read(const vector<string>& words, const string& line, const Catalog& source) const {
+    const string& command = words[0];
+    size_t args = words.size() - 1;
+
+    if (command == "ping") return ok("");
+    if (command == "version") return ok(to_string(versions.version()) + "\n");
+
+    if (command == "get") {
+        if (args != 1) return err("usage: get NAME");
+        ShowId id = source.findShow(stored(words[1]));
+        if (id == noShow) return err("show not found");
+        return ok(formatShowRecord(source.getShow(id)) + "\n");
+    }
+
+    // Reports read the pinned version in place, by ID, without copying rows
+    if (command == "day") {
+        Day day;
+        if (args != 1 || !parseDay(words[1], day)) return err("usage: day DAY");
+        string body;
+        for (ShowId id : source.showsOn(day)) body += formatShowRecord(source.getShow(id)) + "\n";
+        return ok(body);
+    }
+
+    if (command == "channel-shows") {
+        if (args != 1) return err("usage: channel-shows CODE");
+        if (source.findChannelByCode(words[1]) == noChannel) return err("channel not found");
+        const PostingList& ids = source.showsOnChannel(channelCodes.find(words[1]));
+        vector<ShowId> week;
+        week.reserve(ids.size());
+        for (uint32_t id : ids) week.push_back(id);
+        ranges::stable_sort(week, {}, [&](ShowId id) {
+            const show& s = source.getShow(id);
+            return minuteOfWeek(s.dayOfWeek, s.startHour, s.startMinute);
+        });
+        string body;
+        for (ShowId id : week) body += formatShowRecord(source.getShow(id)) + "\n";
+        return ok(body);
+    }
+
+    if (command == "longest" || command == "shortest") {
+        if (args != 0) return err("usage: " + command);
+        DurationStats all = source.durations().all();
+        if (all.count == 0) return ok("");
+        string body;
+        for (ShowId id : source.durations().withDuration(command == "longest" ? all.max : all.min)) {
+            body += formatShowRecord(source.getShow(id)) + "\n";
+        }
+        return ok(body);
+    }
+
+    if (command == "shows" || command == "channels") {
+        size_t offset = 0, limit = defaultRows;
+        if (args > 2 || (args >= 1 && !parseCount(words[1], offset)) || (args == 2 && !parseCount(words[2], limit))) {
+            return err("usage: " + command + " [OFFSET [LIMIT]]");
+        }
+        string body;
+        if (command == "shows") {
+            auto rows = source.shows();
+            auto it = rows.from(source.showAtOffset(offset));
+            for (size_t n = 0; n < limit && it != rows.end(); ++n, ++it) body += formatShowRecord(*it) + "\n";
+        } else {
+            auto rows = source.channels();
+            auto it = rows.from(source.channelAtOffset(offset));
+            for (size_t n = 0; n < limit && it != rows.end(); ++n, ++it) body += formatChannelRecord(*it) + "\n";
+        }
+        return ok(body);
+    }
+
+    if (command == "stats") {
+        DurationStats all = source.durations().all();
+        ostringstream body;
+        body << "shows " << source.showCount() << "\nchannels " << source.channelCount() << "\nversion "
+             << versions.version() << "\nlive-versions " << versions.live() << "\n";
+        if (all.count > 0) {
+            body << "longest " << all.max << "\nshortest " << all.min << "\naverage " << fixed << setprecision(1)
+                 << all.average() << "\n";
+        }
+        // Then one line per operation run so far: calls, then mean, p50, p99
+        // and max in microseconds, then bytes and records moved
+        for (const auto& m : collectMetrics()) {
+            body << "op " << opName(m.op) << " " << m.count << " " << fixed << setprecision(1)
+                 << m.totalNanos / max<uint64_t>(1, m.count) / 1000.0 << " " << m.percentileNanos(50) / 1000.0 << " "
+                 << m.percentileNanos(99) / 1000.0 << " " << m.maxNanos / 1000.0 << " " << m.bytes << " "
+                 << m.records << "\n";
+        }
+        return ok(body.str());
+    }
+
+    if (command == "query" || command == "explain") {
+        // A query sent as one quoted word is used as is; otherwise the parser
+        // gets the raw text, since it does its own quoting
+        string text = words.size() == 2 ? words[1] : line.substr(line.find(command) + command.size());
+        QueryPlan plan;
+        string error;
+        if (!compileQuery(text, source, plan, error)) return err("invalid query: " + error);
+        string body;
+        if (command == "explain") {
+            for (const auto& note : plan.notes) body += note + "\n";
+            return ok(body);
+        }
+        ScratchScope scratch;
+        QueryResult result = runQuery(plan, source, &scratch.arena());
+        for (ShowId id : result.rows) body += formatShowRecord(source.getShow(id)) + "\n";
+        for (const auto& g : result.groups) {
+            ostringstream row;
+            row << g.key << " " << g.stats.count << " " << g.stats.sum << " " << fixed << setprecision(1)
+                << g.stats.average() << " " << g.stats.min << " " << g.stats.max << "\n";
+            body += row.str();
+        }
+        return ok(body);
+    }
+
+    if (command == "search") {
+        if (args == 0) return err("usage: search TEXT...");
+        string text;
+        for (size_t i = 1; i < words.size(); ++i) text += (i > 1 ? " " : "") + words[i];
+        vector<SearchMatch> matches;
+        source.search(text, searchRows, matches);
+        // One line per match: type, match kind, typos, then the record
+        static const char* const targets[] = {"category", "channel", "show"};
+        string body;
+        for (const auto& m : matches) {
+            body += string(targets[static_cast<size_t>(m.target)]) + " " + matchKindName(m.kind) + " " +
+                    to_string(m.typos) + " ";
+            if (m.target == SearchTarget::Show) {
+                body += formatShowRecord(source.getShow(m.id));
+            } else if (m.target == SearchTarget::Channel) {
+                body += formatChannelRecord(source.getChannel(m.id));
+            } else {
+                body += categoryNames.str(m.id);
+            }
+            body += "\n";
+        }
+        return ok(body);
+    }
+
+    return err("unknown command " + command);
+}
+
+// Queues a mutation for the writer and waits until it is durable and visible
+string Server::write(vector<string> words) {
+    Request request;
+    request.words = move(words);
+    {
+        lock_guard<mutex> guard(lock);
+        if (stopping) return err("server is shutting down");
+        queue.push_back(&request);
+    }
+    queued.notify_one();
+    unique_lock<mutex> guard(lock);
+    answered.wait(guard, [&request] { return request.done; });
+    return request.reply;
+}
+
+void Server::stop() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    queued.notify_all();
+}
+
+// Applies everything queued since the last round to one private copy of the
+// catalog, makes the round durable with a single journal write, then
+// publishes the copy and answers every request in it
+void Server::writerLoop() {
+    while (true) {
+        vector<Request*> round;
+        {
+            unique_lock<mutex> guard(lock);
+            queued.wait(guard, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            round.swap(queue);
+        }
+
+        // Shares everything with the current version until a request changes it
+        shared_ptr<Catalog> next = versions.draft();
+        bool changed = false;
+        journal.beginBatch();
+        for (Request* request : round) {
+            request->reply = apply(request->words, *next, changed);
+        }
+        if (!journal.endBatch()) {
+            // Nothing in the round is durable, so none of it is published
+            for (Request* request : round) request->reply = err("could not write the journal");
+            changed = false;
+        }
+
+        if (changed) {
+            if (journal.needsCompaction() && !journal.compact(*next)) {
+                cout << "Warning: could not compact the journal into Program.txt/Channel.txt." << endl;
+            }
+            versions.publish(move(next));
+        }
+        {
+            lock_guard<mutex> guard(lock);
+            for (Request* request : round) request->done = true;
+        }
+        answered.notify_all();
+    }
+}
+
+string Server::apply(const vector<string>& words, Catalog& next, bool& changed) {
+    const string& command = words[0];
+    size_t args = words.size() - 1;
+    CatalogBatch batch;
+    string reply;
+
+    if (command == "add-show" || command == "edit-show") {
+        bool edit = command == "edit-show";
+        if (args != (edit ? 7u : 6u)) {
+            return err(edit ? "usage: edit-show NAME NEW_NAME CATEGORY HH:MM DURATION DAY CODE"
+                            : "usage: add-show NAME CATEGORY HH:MM DURATION DAY CODE");
+        }
+        // Fields in Program.txt order, "-" filled in from the current show
+        vector<string> fields(words.begin() + (edit ? 2 : 1), words.end());
+        string name = stored(words[1]);
+        if (edit) {
+            ShowId id = next.findShow(name);
+            if (id == noShow) return err("show " + name + " does not exist");
+            const show& s = next.getShow(id);
+            fields = {keepOr(fields[0], s.name), keepOr(fields[1], categoryNames.str(s.category)),
+                      keepOr(fields[2], formatStartTime(s.startHour, s.startMinute)),
+                      keepOr(fields[3], to_string(s.duration)), keepOr(fields[4], dayName(s.dayOfWeek)),
+                      keepOr(fields[5], channelCodes.str(s.channelCode))};
+        }
+        string record;
+        for (const auto& f : fields) record += (record.empty() ? "" : " ") + stored(f);
+        show s;
+        if (!parseShowRecord(record, s)) return err("invalid show " + record);
+        if (edit) {
+            batch.updateShow(name, move(s));
+        } else {
+            batch.insertShow(move(s));
+        }
+    } else if (command == "delete-show") {
+        if (args != 1) return err("usage: delete-show NAME");
+        batch.eraseShow(stored(words[1]));
+    } else if (command == "add-channel") {
+        if (args != 2) return err("usage: add-channel NAME COUNTRY");
+        string code = to_string(next.maxNumericChannelCode() + 1);
+        batch.insertChannel({code, stored(words[1]), stored(words[2])});
+        reply = code + "\n";
+    } else if (command == "edit-channel" || command == "delete-channel") {
+        bool edit = command == "edit-channel";
+        bool cascade = !edit && args == 2 && words[2] == "cascade";
+        if (args != (edit ? 3u : cascade ? 2u : 1u)) return err(edit ? "usage: edit-channel NAME NEW_NAME COUNTRY"
+                                                                     : "usage: delete-channel NAME [cascade]");
+        ChannelId id = next.findChannelByName(stored(words[1]));
+        if (id == noChannel) return err("channel " + stored(words[1]) + " does not exist");
+        const channel& c = next.getChannel(id);
+        if (edit) {
+            batch.updateChannel({c.code, keepOr(words[2], c.name), keepOr(words[3], c.originCountry)});
+        } else {
+            batch.eraseChannel(c.code, cascade ? ChannelErase::Cascade : ChannelErase::Refuse);
+        }
+    }
+
+    string error;
+    if (!batch.applyInPlace(next, journal, error)) return err(error);
+    changed = true;
+    return ok(reply);
+}
+
+static void serveConnection(Server& server, int fd, shared_ptr<atomic<bool>> done) {
+    Connection connection(fd);
+    string line;
+    while (connection.readLine(line, true)) {
+        if (line == "quit") break;
+        if (!connection.send(server.handle(line))) break;
+    }
+    done->store(true);
+}
+
+int runServer(const string& address, const Catalog& initial, Journal& journal) {
+    // Refuse to take over the address of a server that is still running
+    string error;
+    int probe = openSocket(address, false, error);
+    if (probe >= 0) {
+        ::close(probe);
+        cout << "Error: a server is already listening on " << address << "." << endl;
+        return 1;
+    }
+    int listener = openSocket(address, true, error);
+    if (listener < 0) {
+        cout << "Error: could not listen on " << address << ": " << error << "." << endl;
+        return 1;
+    }
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+    signal(SIGPIPE, SIG_IGN);
+
+    Server server(initial, journal);
+    thread writer([&server] { server.writerLoop(); });
+    cout << "Serving " << initial.showCount() << " shows and " << initial.channelCount() << " channels on "
+         << address << " (Ctrl+C to stop)." << endl;
+
+    struct Client {
+        thread worker;
+        shared_ptr<atomic<bool>> done;
+    };
+    list<Client> clients;
+    auto reap = [&clients] {
+        for (auto it = clients.begin(); it != clients.end();) {
+            if (it->done->load()) {
+                it->worker.join();
+                it = clients.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    };
+
+    while (!stopRequested) {
+        pollfd p {listener, POLLIN, 0};
+        if (::poll(&p, 1, pollMillis) > 0) {
+            int fd = ::accept(listener, nullptr, nullptr);
+            if (fd >= 0) {
+                ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+                if (isTcp(address)) {
+                    int one = 1;
+                    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+                }
+                auto done = make_shared<atomic<bool>>(false);
+                clients.push_back({thread(serveConnection, ref(server), fd, done), done});
+            }
+        }
+        reap();
+    }
+
+    ::close(listener);
+    if (!isTcp(address)) ::unlink(address.c_str());
+    for (auto& c : clients) c.worker.join();
+    server.stop();
+    writer.join();
+
+    // Leave Program.txt/Channel.txt up to date for the next start
+    if (journal.size() > 0 && !journal.compact(*server.snapshot())) {
+        cout << "Warning: changes remain in Catalog.journal and will be replayed on next start." << endl;
+    }
+    cout << "Server stopped." << endl;
+    return 0;
+}
+
+// Sends one request and reads its reply; false if the connection failed.
+// An ERR reply comes back with ok = false and its message in body.
+static bool roundTrip(Connection& connection, const string& request, string& body, bool& ok) {
+    string header;
+    if (!connection.send(request + "\n") || !connection.readLine(header, false)) return false;
+    if (header.starts_with("OK ")) {
+        size_t length = 0;
+        ok = true;
+        return parseCount(header.substr(3), length) && connection.readExactly(length, body);
+    }
+    ok = false;
+    body = header.starts_with("ERR ") ? header.substr(4) : header;
+    return true;
+}
+
+int runRemote(const string& address, const string& request) {
+    string error;
+    Connection connection(openSocket(address, false, error));
+    if (!connection.valid()) {
+        cout << "Error: could not connect to " << address << ": " << error << "." << endl;
+        return 1;
+    }
+    string body;
+    bool ok = false;
+    if (!roundTrip(connection, request, body, ok)) {
+        cout << "Error: the connection to " << address << " was lost." << endl;
+        return 1;
+    }
+    if (!ok) {
+        cout << "Error: " << body << endl;
+        return 1;
+    }
+    cout << body;
+    return 0;
+}
+
+struct LatencyLog {
+    vector<uint32_t> reads;     // microseconds
+    vector<uint32_t> writes;
+    size_t errors = 0;
+    size_t dropped = 0;         // connections that failed
+};
+
+static void printLatencies(const char* label, vector<uint32_t>& micros, double seconds) {
+    if (micros.empty()) {
+        cout << label << ": none" << endl;
+        return;
+    }
+    ranges::sort(micros);
+    auto at = [&micros](double p) { return micros[static_cast<size_t>(p * static_cast<double>(micros.size() - 1))]; };
+    cout << label << ": " << micros.size() << " (" << static_cast<uint64_t>(static_cast<double>(micros.size()) / seconds)
+         << "/s), latency us p50 " << at(0.5) << ", p90 " << at(0.9) << ", p99 " << at(0.99) << ", max "
+         << micros.back() << endl;
+}
+
+// One client of the load generator. Writes add and then delete one-minute
+// shows on a channel of its own, so they never conflict with anyone's;
+// reads alternate between name lookups and small queries.
+static void generateLoad(const string& address, unsigned worker, chrono::steady_clock::time_point deadline,
+                         unsigned writePercent, const vector<string>& names, LatencyLog& log) {
+    string error, body;
+    bool ok = false;
+    Connection connection(openSocket(address, false, error));
+    string channelName = "loadgen_" + to_string(::getpid()) + "_" + to_string(worker);
+    if (!connection.valid() || !roundTrip(connection, "add-channel " + channelName + " Loadgen", body, ok) || !ok) {
+        log.dropped++;
+        return;
+    }
+    string code = body.substr(0, body.find('\n'));
+
+    mt19937 rng(worker);
+    string live;        // the show this client has on the air, if any
+    uint32_t slot = 0;
+    while (chrono::steady_clock::now() < deadline) {
+        bool writing = rng() % 100 < writePercent;
+        string request;
+        if (writing && live.empty()) {
+            live = channelName + "_" + to_string(slot);
+            uint32_t minute = slot++ % (daysPerWeek * minutesPerDay);
+            request = "add-show " + live + " Loadgen " + formatStartTime(static_cast<int>(minute % minutesPerDay / 60),
+                      static_cast<int>(minute % 60)) + " 1 " + dayName(static_cast<Day>(minute / minutesPerDay)) +
+                      " " + code;
+        } else if (writing) {
+            request = "delete-show " + live;
+            live.clear();
+        } else if (!names.empty() && rng() % 2 == 0) {
+            request = "get " + names[rng() % names.size()];
+        } else {
+            request = "query shows where day = " + dayName(static_cast<Day>(rng() % daysPerWeek)) +
+                      " and duration >= " + to_string(rng() % 120) + " limit 10";
+        }
+
+        auto started = chrono::steady_clock::now();
+        if (!roundTrip(connection, request, body, ok)) {
+            log.dropped++;
+            return;
+        }
+        auto micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - started).count();
+        (writing ? log.writes : log.reads).push_back(static_cast<uint32_t>(micros));
+        if (!ok) log.errors++;
+    }
+
+    roundTrip(connection, "delete-channel " + channelName + " cascade", body, ok);
+}
+
+int runLoadGenerator(const string& address, unsigned clients, unsigned seconds, unsigned writePercent) {
+    signal(SIGPIPE, SIG_IGN);
+    string error, body;
+    bool ok = false;
+    vector<string> names;
+    {
+        Connection connection(openSocket(address, false, error));
+        if (!connection.valid()) {
+            cout << "Error: could not connect to " << address << ": " << error << "." << endl;
+            return 1;
+        }
+        // Shows to look up by name
+        if (roundTrip(connection, "shows 0 1000", body, ok) && ok) {
+            istringstream lines(body);
+            string line;
+            while (getline(lines, line)) names.push_back(line.substr(0, line.find(' ')));
+        }
+    }
+
+    cout << "Running " << clients << " clients for " << seconds << " s with " << writePercent << "% writes..." << endl;
+    vector<LatencyLog> logs(clients);
+    vector<thread> threads;
+    auto started = chrono::steady_clock::now();
+    auto deadline = started + chrono::seconds(seconds);
+    for (unsigned w = 0; w < clients; ++w) {
+        threads.emplace_back(generateLoad, cref(address), w, deadline, writePercent, cref(names), ref(logs[w]));
+    }
+    for (auto& t : threads) t.join();
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+    LatencyLog all;
+    for (auto& log : logs) {
+        all.reads.insert(all.reads.end(), log.reads.begin(), log.reads.end());
+        all.writes.insert(all.writes.end(), log.writes.begin(), log.writes.end());
+        all.errors += log.errors;
+        all.dropped += log.dropped;
+    }
+    cout << "Requests: " << all.reads.size() + all.writes.size() << " in " << fixed << setprecision(1) << elapsed
+         << " s" << defaultfloat << endl;
+    printLatencies("Reads", all.reads, elapsed);
+    printLatencies("Writes", all.writes, elapsed);
+    cout << "Error replies: " << all.errors << ", failed connections: " << all.dropped << endl;
+    return all.dropped == 0 ? 0 : 1;
+}
+
+#else
+
+int runServer(const string&, const Catalog&, Journal&) {
+    cout << "Server mode is only available on POSIX systems." << endl;
+    return 1;
+}
+
+int runRemote(const string&, const string&) {
+    cout << "Server mode is only available on POSIX systems." << endl;
+    return 1;
+}
+
+int runLoadGenerator(const string&, unsigned, unsigned, unsigned) {
+    cout << "Server mode is only available on POSIX systems." << endl;
+    return 1;
+}
+
+#endif
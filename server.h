@@ -0,0 +1,44 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <string>
+#include <vector>
+#include "catalog.h"
+#include "journal.h"
+
+using namespace std;
+
+// Daemon mode: keeps the catalog resident and serves any number of clients
+// over a Unix domain socket (ADDRESS is its path) or localhost TCP
+// (ADDRESS is tcp:PORT). Each request is one line, words split as on the
+// command line; each reply is "OK <bytes>\n" followed by that many bytes of
+// body, or "ERR <message>\n".
+//
+//   reads    ping | version | get NAME | shows [OFFSET [LIMIT]]
+//            channels [OFFSET [LIMIT]] | day DAY | longest | shortest
+//            channel-shows CODE | stats | query TEXT | explain TEXT
+//            search TEXT...
+//   writes   add-show NAME CATEGORY HH:MM DURATION DAY CODE
+//            edit-show NAME NEW_NAME CATEGORY HH:MM DURATION DAY CODE
+//            delete-show NAME | add-channel NAME COUNTRY
+//            edit-channel NAME NEW_NAME COUNTRY
+//            delete-channel NAME [cascade]   (cascade also deletes its shows)
+//            (- keeps a field in the edit commands)
+//
+// Readers pin the current catalog version (see versions.h) with one atomic
+// load and never wait for writers. Writes are queued to a single writer
+// thread. It applies everything queued so far to one draft version, logs the
+// group to the journal with a single fsync, publishes the draft, and only
+// then answers. A client therefore always reads its own writes.
+//
+// Runs until SIGINT or SIGTERM, then folds the journal into the text files.
+int runServer(const string& address, const Catalog& initial, Journal& journal);
+
+// Sends one request and prints the reply body; returns the exit status
+int runRemote(const string& address, const string& request);
+
+// Drives a running server from several client connections for a while, with
+// the given share of writes, and reports throughput and latency percentiles
+int runLoadGenerator(const string& address, unsigned clients, unsigned seconds, unsigned writePercent);
+
+#endif // SERVER_H
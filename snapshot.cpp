@@ -0,0 +1,230 @@
+#include "snapshot.h"
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+#include "journal.h"
+#include "metrics.h"
+
+static constexpr char snapshotMagic[4] = {'T', 'V', 'C', 'S'};
+static constexpr uint32_t snapshotByteOrder = 0x01020304;
+
+static size_t padTo4(size_t n) {
+    return (n + 3) & ~static_cast<size_t>(3);
+}
+
+template <typename T>
+static void appendRaw(string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Assigns each distinct string an index in first-seen order
+class StringTableBuilder {
+public:
+    uint32_t add(string_view s) {
+        auto [it, inserted] = ids.try_emplace(s, static_cast<uint32_t>(strings.size()));
+        if (inserted) strings.push_back(s);
+        return it->second;
+    }
+
+    void write(string& out) const {
+        uint32_t offset = 0;
+        for (auto s : strings) {
+            appendRaw(out, offset);
+            offset += static_cast<uint32_t>(s.size());
+        }
+        appendRaw(out, offset);
+        for (auto s : strings) out.append(s);
+        out.append(padTo4(offset) - offset, '\0');
+    }
+
+    uint32_t count() const { return static_cast<uint32_t>(strings.size()); }
+    uint32_t bytes() const {
+        size_t total = 0;
+        for (auto s : strings) total += s.size();
+        return static_cast<uint32_t>(total);
+    }
+
+private:
+    unordered_map<string_view, uint32_t> ids;
+    vector<string_view> strings;
+};
+
+bool writeSnapshot(const string& path, const Catalog& source) {
+    OpTimer timer(Op::SnapshotWrite);
+    StringTableBuilder strings;
+    vector<SnapshotChannel> channelRecords;
+    vector<SnapshotShow> showRecords;
+    channelRecords.reserve(source.channelCount());
+    showRecords.reserve(source.showCount());
+
+    for (const auto& c : source.channels()) {
+        channelRecords.push_back({strings.add(c.code), strings.add(c.name), strings.add(c.originCountry)});
+    }
+    for (const auto& s : source.shows()) {
+        SnapshotShow r {};
+        r.name = strings.add(s.name);
+        r.category = strings.add(categoryNames.str(s.category));
+        r.dayOfWeek = strings.add(dayName(s.dayOfWeek));
+        r.channelCode = strings.add(channelCodes.str(s.channelCode));
+        r.startMinute = static_cast<uint16_t>(s.startHour * 60 + s.startMinute);
+        r.duration = static_cast<uint32_t>(s.duration);
+        showRecords.push_back(r);
+    }
+
+    SnapshotHeader header {};
+    memcpy(header.magic, snapshotMagic, sizeof header.magic);
+    header.version = snapshotVersion;
+    header.byteOrder = snapshotByteOrder;
+    header.stringCount = strings.count();
+    header.stringBytes = strings.bytes();
+    header.channelCount = static_cast<uint32_t>(channelRecords.size());
+    header.showCount = static_cast<uint32_t>(showRecords.size());
+
+    string out;
+    out.reserve(sizeof header + (header.stringCount + 1) * 4 + padTo4(header.stringBytes) +
+                channelRecords.size() * sizeof(SnapshotChannel) + showRecords.size() * sizeof(SnapshotShow));
+    appendRaw(out, header);
+    strings.write(out);
+    out.append(reinterpret_cast<const char*>(channelRecords.data()), channelRecords.size() * sizeof(SnapshotChannel));
+    out.append(reinterpret_cast<const char*>(showRecords.data()), showRecords.size() * sizeof(SnapshotShow));
+
+    timer.io(out.size(), showRecords.size() + channelRecords.size());
+    return writeFileAtomically(path, out);
+}
+
+SnapshotReader::SnapshotReader(const string& path) : file(path) {
+    if (!file.isOpen()) {
+        fail("cannot open " + path);
+        return;
+    }
+    string_view data = file.contents();
+    if (data.size() < sizeof header) {
+        fail("file too small");
+        return;
+    }
+    memcpy(&header, data.data(), sizeof header);
+    if (memcmp(header.magic, snapshotMagic, sizeof header.magic) != 0) {
+        fail("not a catalog snapshot");
+        return;
+    }
+    if (header.byteOrder != snapshotByteOrder) {
+        fail("snapshot was written with a different byte order");
+        return;
+    }
+    if (header.version != snapshotVersion) {
+        fail("unsupported snapshot version " + to_string(header.version));
+        return;
+    }
+
+    uint64_t offsetsBytes = (uint64_t(header.stringCount) + 1) * 4;
+    uint64_t expected = sizeof header + offsetsBytes + padTo4(header.stringBytes) +
+                        uint64_t(header.channelCount) * sizeof(SnapshotChannel) +
+                        uint64_t(header.showCount) * sizeof(SnapshotShow);
+    if (expected != data.size()) {
+        fail("size does not match header");
+        return;
+    }
+
+    offsets = data.data() + sizeof header;
+    blob = offsets + offsetsBytes;
+    channelRecords = blob + padTo4(header.stringBytes);
+    showRecords = channelRecords + size_t(header.channelCount) * sizeof(SnapshotChannel);
+
+    // Validate once up front so the accessors can trust every index
+    uint32_t previous = 0;
+    for (uint32_t i = 0; i <= header.stringCount; ++i) {
+        uint32_t offset;
+        memcpy(&offset, offsets + size_t(i) * 4, 4);
+        if (offset < previous || offset > header.stringBytes) {
+            fail("corrupt string table");
+            return;
+        }
+        previous = offset;
+    }
+    for (uint32_t i = 0; i < header.channelCount; ++i) {
+        SnapshotChannel r;
+        memcpy(&r, channelRecords + size_t(i) * sizeof r, sizeof r);
+        if (r.code >= header.stringCount || r.name >= header.stringCount || r.originCountry >= header.stringCount) {
+            fail("corrupt channel record " + to_string(i));
+            return;
+        }
+    }
+    for (uint32_t i = 0; i < header.showCount; ++i) {
+        SnapshotShow r;
+        memcpy(&r, showRecords + size_t(i) * sizeof r, sizeof r);
+        Day day;
+        if (r.name >= header.stringCount || r.category >= header.stringCount ||
+            r.dayOfWeek >= header.stringCount || r.channelCode >= header.stringCount ||
+            r.startMinute >= 24 * 60 || r.duration == 0 || r.duration > INT32_MAX ||
+            !parseDay(stringAt(r.dayOfWeek), day)) {
+            fail("corrupt show record " + to_string(i));
+            return;
+        }
+    }
+    valid = true;
+}
+
+bool SnapshotReader::fail(const string& reason) {
+    problem = reason;
+    valid = false;
+    return false;
+}
+
+string_view SnapshotReader::stringAt(uint32_t id) const {
+    uint32_t bounds[2];
+    memcpy(bounds, offsets + size_t(id) * 4, sizeof bounds);
+    return {blob + bounds[0], bounds[1] - bounds[0]};
+}
+
+ShowView SnapshotReader::showAt(uint32_t index) const {
+    SnapshotShow r;
+    memcpy(&r, showRecords + size_t(index) * sizeof r, sizeof r);
+    ShowView view;
+    view.name = stringAt(r.name);
+    view.category = stringAt(r.category);
+    view.startHour = r.startMinute / 60;
+    view.startMinute = r.startMinute % 60;
+    view.duration = static_cast<int>(r.duration);
+    parseDay(stringAt(r.dayOfWeek), view.dayOfWeek);
+    view.channelCode = stringAt(r.channelCode);
+    return view;
+}
+
+ChannelView SnapshotReader::channelAt(uint32_t index) const {
+    SnapshotChannel r;
+    memcpy(&r, channelRecords + size_t(index) * sizeof r, sizeof r);
+    return {stringAt(r.code), stringAt(r.name), stringAt(r.originCountry)};
+}
+
+bool readSnapshot(const string& path, Catalog& target, string& error) {
+    OpTimer timer(Op::SnapshotRead);
+    SnapshotReader reader(path);
+    if (!reader.isValid()) {
+        error = reader.error();
+        return false;
+    }
+
+    Catalog loaded;
+    loaded.reserve(reader.showCount(), reader.channelCount());
+    // A snapshot is written from one catalog, so a clash means it is corrupt;
+    // loading the rest would silently drop records
+    for (uint32_t i = 0; i < reader.channelCount(); ++i) {
+        if (loaded.insertChannel(toChannel(reader.channelAt(i))) == noChannel) {
+            error = "corrupt snapshot: channel record " + to_string(i) + " repeats a code or name";
+            return false;
+        }
+    }
+    InternCache categories(categoryNames);
+    InternCache codes(channelCodes);
+    for (uint32_t i = 0; i < reader.showCount(); ++i) {
+        if (loaded.insertShow(toShow(reader.showAt(i), categories, codes)) == noShow) {
+            error = "corrupt snapshot: show record " + to_string(i) + " repeats a name";
+            return false;
+        }
+    }
+    target = move(loaded);
+    error_code ec;
+    uintmax_t bytes = filesystem::file_size(path, ec);
+    timer.io(ec ? 0 : bytes, reader.showCount() + reader.channelCount());
+    return true;
+}
@@ -0,0 +1,86 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "catalog.h"
+#include "loader.h"
+
+using namespace std;
+
+// Binary catalog snapshot (.tvcs), all integers in the writer's byte order:
+//
+//   header        SnapshotHeader
+//   offsets       uint32[stringCount + 1], string i is blob[offsets[i], offsets[i + 1])
+//   blob          stringBytes of text, padded to a multiple of 4
+//   channels      SnapshotChannel[channelCount]
+//   shows         SnapshotShow[showCount]
+//
+// Every name, category, day, country and channel code is stored once in the
+// string table; records refer to it by index. Strings keep the '_' encoding of
+// the text files.
+constexpr uint32_t snapshotVersion = 1;
+
+struct SnapshotHeader {
+    char magic[4];              // "TVCS"
+    uint32_t version;
+    uint32_t byteOrder;         // 0x01020304 as written
+    uint32_t stringCount;
+    uint32_t stringBytes;
+    uint32_t channelCount;
+    uint32_t showCount;
+    uint32_t reserved;
+};
+
+struct SnapshotChannel {
+    uint32_t code;
+    uint32_t name;
+    uint32_t originCountry;
+};
+
+struct SnapshotShow {
+    uint32_t name;
+    uint32_t category;
+    uint32_t dayOfWeek;
+    uint32_t channelCode;       // same string as the channel's code
+    uint16_t startMinute;       // minutes after midnight
+    uint16_t reserved;
+    uint32_t duration;
+};
+
+// Memory-maps a snapshot and serves its records as views into the mapping,
+// without allocating per record
+class SnapshotReader {
+public:
+    explicit SnapshotReader(const string& path);
+
+    bool isValid() const { return valid; }
+    const string& error() const { return problem; }
+
+    uint32_t showCount() const { return header.showCount; }
+    uint32_t channelCount() const { return header.channelCount; }
+    ShowView showAt(uint32_t index) const;
+    ChannelView channelAt(uint32_t index) const;
+
+private:
+    bool fail(const string& reason);
+    string_view stringAt(uint32_t id) const;
+
+    MappedFile file;
+    SnapshotHeader header {};
+    const char* offsets = nullptr;
+    const char* blob = nullptr;
+    const char* channelRecords = nullptr;
+    const char* showRecords = nullptr;
+    bool valid = false;
+    string problem;
+};
+
+bool writeSnapshot(const string& path, const Catalog& source);
+
+// Replaces the catalog contents with the snapshot. Returns false (leaving the
+// catalog untouched) if the file is missing or corrupt.
+bool readSnapshot(const string& path, Catalog& target, string& error);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,192 @@
+#include "table.h"
+#include <charconv>
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+bool parseTableFormat(string_view text, TableFormat& format) {
+    if (text == "text") {
+        format = TableFormat::Text;
+    } else if (text == "csv") {
+        format = TableFormat::Csv;
+    } else if (text == "json") {
+        format = TableFormat::Json;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+Table::Table(vector<TableColumn> columns) : columns(move(columns)) {
+    for (const auto& c : this->columns) widths.push_back(strlen(c.title));
+}
+
+void Table::reserve(size_t rows, size_t bytesPerRow) {
+    text.reserve(rows * bytesPerRow);
+    ends.reserve(rows * columns.size());
+}
+
+void Table::fixWidths(vector<size_t> fixed) {
+    widths = move(fixed);
+    widths.resize(columns.size(), 1);
+    for (size_t& w : widths) w = max<size_t>(w, 1);
+    fixedWidths = true;
+}
+
+Table& Table::endCell() {
+    size_t column = ends.size() % columns.size();
+    size_t begin = ends.empty() ? 0 : ends.back();
+    size_t width = text.size() - begin;
+    if (columns[column].numeric) width += strlen(columns[column].unit);
+    if (!fixedWidths && width > widths[column]) widths[column] = width;
+    ends.push_back(static_cast<uint32_t>(text.size()));
+    return *this;
+}
+
+Table& Table::cell(string_view s) {
+    text.append(s);
+    return endCell();
+}
+
+Table& Table::decodedCell(string_view s) {
+    size_t at = text.size();
+    text.append(s);
+    for (size_t i = at; i < text.size(); ++i) {
+        if (text[i] == '_') text[i] = ' ';
+    }
+    return endCell();
+}
+
+Table& Table::number(int64_t value) {
+    char digits[24];
+    auto result = to_chars(digits, digits + sizeof digits, value);
+    text.append(digits, result.ptr);
+    return endCell();
+}
+
+Table& Table::time(int hour, int minute) {
+    char hhmm[5] = {char('0' + hour / 10), char('0' + hour % 10), ':', char('0' + minute / 10), char('0' + minute % 10)};
+    text.append(hhmm, sizeof hhmm);
+    return endCell();
+}
+
+string_view Table::cellAt(size_t row, size_t column) const {
+    size_t index = row * columns.size() + column;
+    size_t begin = index == 0 ? 0 : ends[index - 1];
+    return string_view(text).substr(begin, ends[index] - begin);
+}
+
+void Table::renderText(string& out) const {
+    size_t total = columns.size() + 1;
+    for (size_t w : widths) total += w + 2;
+    string rule(total, '-');
+    rule += '\n';
+
+    auto pad = [&out](string_view s, string_view unit, size_t width) {
+        out += "| ";
+        if (s.size() + unit.size() > width) {
+            // Only happens with fixed widths
+            string cell = string(s) + string(unit);
+            out.append(cell, 0, width - 1);
+            out += "~ ";
+            return;
+        }
+        out.append(s);
+        out.append(unit);
+        out.append(width + 1 - s.size() - unit.size(), ' ');
+    };
+
+    out.reserve(out.size() + (rows() + 4) * total);
+    out += rule;
+    for (size_t c = 0; c < columns.size(); ++c) pad(columns[c].title, {}, widths[c]);
+    out += "|\n";
+    out += rule;
+    for (size_t r = 0; r < rows(); ++r) {
+        for (size_t c = 0; c < columns.size(); ++c) {
+            pad(cellAt(r, c), columns[c].numeric ? columns[c].unit : "", widths[c]);
+        }
+        out += "|\n";
+    }
+    out += rule;
+}
+
+// Quotes a CSV field only when it needs it
+static void appendCsvField(string& out, string_view s) {
+    if (s.find_first_of(",\"\n") == string_view::npos) {
+        out.append(s);
+        return;
+    }
+    out += '"';
+    for (char ch : s) {
+        if (ch == '"') out += '"';
+        out += ch;
+    }
+    out += '"';
+}
+
+void Table::renderCsv(string& out) const {
+    for (size_t c = 0; c < columns.size(); ++c) {
+        if (c) out += ',';
+        appendCsvField(out, columns[c].title);
+    }
+    out += '\n';
+    for (size_t r = 0; r < rows(); ++r) {
+        for (size_t c = 0; c < columns.size(); ++c) {
+            if (c) out += ',';
+            appendCsvField(out, cellAt(r, c));
+        }
+        out += '\n';
+    }
+}
+
+static void appendJsonString(string& out, string_view s) {
+    out += '"';
+    for (char ch : s) {
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            char escaped[7];
+            snprintf(escaped, sizeof escaped, "\\u%04x", ch);
+            out += escaped;
+        } else {
+            out += ch;
+        }
+    }
+    out += '"';
+}
+
+void Table::renderJson(string& out) const {
+    out += '[';
+    for (size_t r = 0; r < rows(); ++r) {
+        out += r ? ",\n  {" : "\n  {";
+        for (size_t c = 0; c < columns.size(); ++c) {
+            if (c) out += ", ";
+            appendJsonString(out, columns[c].key);
+            out += ": ";
+            if (columns[c].numeric) {
+                out.append(cellAt(r, c));
+            } else {
+                appendJsonString(out, cellAt(r, c));
+            }
+        }
+        out += '}';
+    }
+    out += rows() ? "\n]\n" : "]\n";
+}
+
+void Table::render(TableFormat format, string& out) const {
+    switch (format) {
+        case TableFormat::Text: renderText(out); break;
+        case TableFormat::Csv: renderCsv(out); break;
+        case TableFormat::Json: renderJson(out); break;
+    }
+}
+
+void Table::print(TableFormat format) const {
+    string out;
+    render(format, out);
+    cout.write(out.data(), static_cast<streamsize>(out.size()));
+    cout.flush();
+}
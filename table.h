@@ -0,0 +1,66 @@
+#ifndef TABLE_H
+#define TABLE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+enum class TableFormat : uint8_t {
+    Text,       // boxed table for the terminal
+    Csv,
+    Json        // array of objects keyed by column
+};
+
+// Accepts "text", "csv" and "json"
+bool parseTableFormat(string_view text, TableFormat& format);
+
+struct TableColumn {
+    const char* title;      // header in text and CSV output
+    const char* key;        // field name in JSON output
+    const char* unit = "";  // appended to numbers in text output only
+    bool numeric = false;   // written unquoted in JSON
+};
+
+// Collects rows into one text buffer and renders them in a single pass, so
+// listing a large catalog costs no per-cell strings and no per-line flushes.
+// Text output pads every column to its widest cell.
+class Table {
+public:
+    explicit Table(vector<TableColumn> columns);
+
+    void reserve(size_t rows, size_t bytesPerRow = 64);
+
+    // Cells are added left to right; a row is complete once every column has one
+    Table& cell(string_view text);
+    Table& decodedCell(string_view text);       // shows '_' as a space
+    Table& number(int64_t value);
+    Table& time(int hour, int minute);          // HH:MM
+
+    size_t rows() const { return ends.size() / columns.size(); }
+
+    // Text output uses these widths instead of the widest cell, cutting longer
+    // cells short with '~', so that consecutive pages line up
+    void fixWidths(vector<size_t> fixed);
+    const vector<size_t>& columnWidths() const { return widths; }
+
+    void render(TableFormat format, string& out) const;
+    void print(TableFormat format) const;       // renders to stdout in one write
+
+private:
+    Table& endCell();
+    void renderText(string& out) const;
+    void renderCsv(string& out) const;
+    void renderJson(string& out) const;
+    string_view cellAt(size_t row, size_t column) const;
+
+    vector<TableColumn> columns;
+    vector<size_t> widths;          // widest cell per column, text format
+    bool fixedWidths = false;
+    string text;                    // every cell back to back
+    vector<uint32_t> ends;          // end offset of each cell in text, row-major
+};
+
+#endif // TABLE_H
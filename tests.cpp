@@ -0,0 +1,344 @@
+// Regression tests, run by ctest. Each test works in its own scratch
+// directory and reports what went wrong; the exit status is the number of
+// failed tests.
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#include "arena.h"
+#include "batch.h"
+#include "durable.h"
+#include "catalog.h"
+#include "journal.h"
+#include "loader.h"
+#include "metrics.h"
+#include "query.h"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const string& what) {
+    if (!condition) {
+        cout << "  FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+static void writeText(const filesystem::path& path, const string& text) {
+    ofstream(path, ios::binary) << text;
+}
+
+static string readText(const filesystem::path& path) {
+    ifstream in(path, ios::binary);
+    stringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+static bool hasLine(const string& text, const string& line) {
+    return ("\n" + text).find("\n" + line + "\n") != string::npos;
+}
+
+// Lines the loader rejects must survive a compaction rewriting the files
+static void rejectedLinesSurviveCompaction(const filesystem::path& dir) {
+    auto programs = dir / "Program.txt";
+    auto channels = dir / "Channel.txt";
+    writeText(programs, "A Stiri 10:00 30 Luni 1\n"
+                        "B Stiri 11:00 30 Lunes 1\n"
+                        "C Stiri 25:00 30 Luni 1\n"
+                        "A Film 12:00 90 Marti 1\n");
+    writeText(channels, "1 ProTV Romania\n"
+                        "2 ProTV Romania\n"
+                        "broken\n");
+
+    Catalog loaded;
+    LoadReport programReport = loadPrograms(programs.string(), loaded);
+    LoadReport channelReport = loadChannels(channels.string(), loaded);
+    check(programReport.errors.size() == 3, "three program lines rejected");
+    check(channelReport.errors.size() == 2, "two channel lines rejected");
+
+    Journal log((dir / "Catalog.journal").string(), programs.string(), channels.string());
+    log.keepRejected(programReport, channelReport);
+    show added {"D", categoryNames.intern("Stiri"), channelCodes.intern("1"), 30, 13, 0, Day::Monday};
+    loaded.insertShow(added);
+    log.logInsertShow(added);
+    check(log.compact(loaded), "compaction succeeds");
+
+    string programText = readText(programs);
+    for (const char* line : {"A Stiri 10:00 30 Luni 1", "D Stiri 13:00 30 Luni 1", "B Stiri 11:00 30 Lunes 1",
+                             "C Stiri 25:00 30 Luni 1", "A Film 12:00 90 Marti 1"}) {
+        check(hasLine(programText, line), string("Program.txt keeps \"") + line + "\"");
+    }
+    string channelText = readText(channels);
+    for (const char* line : {"1 ProTV Romania", "2 ProTV Romania", "broken"}) {
+        check(hasLine(channelText, line), string("Channel.txt keeps \"") + line + "\"");
+    }
+
+    // Loading the rewritten files gives the same catalog and rejects the same lines
+    Catalog reloaded;
+    check(loadPrograms(programs.string(), reloaded).errors.size() == 3, "reload rejects the program lines again");
+    check(loadChannels(channels.string(), reloaded).errors.size() == 2, "reload rejects the channel lines again");
+    check(reloaded.showCount() == 2 && reloaded.hasShow("D"), "reload has the compacted shows");
+}
+
+// Start times must be HH:MM with nothing else in either part
+static void startTimesAreParsedWhole(const filesystem::path&) {
+    Catalog empty;
+    QueryPlan plan;
+    string error;
+    for (const char* bad : {"1x:30", "12:3z", ":30", "12:", "1230", "24:00"}) {
+        check(!compileQuery(string("shows where start >= ") + bad, empty, plan, error),
+              string("start ") + bad + " is rejected");
+    }
+    check(compileQuery("shows where start >= 7:05", empty, plan, error), "start 7:05 is accepted");
+}
+
+// Grouped full scans run through the column kernel; their groups must match
+// adding the shows up one by one
+static void groupedQueriesMatchTheShows(const filesystem::path&) {
+    Catalog source;
+    source.insertChannel({"1", "ProTV", "Romania"});
+    source.insertChannel({"2", "Antena", "Romania"});
+    source.insertChannel({"3", "RaiUno", "Italia"});
+    CategoryId news = categoryNames.intern("Stiri");
+    CategoryId film = categoryNames.intern("Film");
+    ChannelCodeId codes[] = {channelCodes.intern("1"), channelCodes.intern("2"), channelCodes.intern("3")};
+    for (int i = 0; i < 60; ++i) {
+        show s{"S" + to_string(i), i % 3 ? news : film, codes[i % 3], 10 + i, static_cast<uint8_t>(i % 24), 0,
+               static_cast<Day>(i % 7)};
+        source.insertShow(s);
+    }
+    source.eraseShow(source.findShow("S7"));
+
+    auto groups = [&](const string& text) {
+        QueryPlan plan;
+        string error;
+        map<string, pair<uint32_t, int64_t>> found;
+        if (!compileQuery(text, source, plan, error)) return found;
+        check(ranges::any_of(plan.notes, [](const string& note) { return note.starts_with("aggregate:"); }),
+              text + " uses the grouped column pass");
+        for (const auto& g : runQuery(plan, source).groups) found[string(g.key)] = {g.stats.count, g.stats.sum};
+        return found;
+    };
+    auto expected = [&](auto key, auto keep) {
+        map<string, pair<uint32_t, int64_t>> totals;
+        for (const auto& s : source.shows()) {
+            if (!keep(s)) continue;
+            auto& total = totals[key(s)];
+            total.first++;
+            total.second += s.duration;
+        }
+        return totals;
+    };
+    auto all = [](const show&) { return true; };
+    auto country = [&](const show& s) {
+        return source.getChannel(source.findChannelByCode(channelCodes.str(s.channelCode))).originCountry;
+    };
+    auto day = [](const show& s) { return string(dayName(s.dayOfWeek)); };
+
+    check(groups("shows group by category") ==
+              expected([](const show& s) { return string(categoryNames.str(s.category)); }, all),
+          "group by category");
+    check(groups("shows group by day") == expected(day, all), "group by day");
+    check(groups("shows group by country") == expected(country, all), "group by country");
+    check(groups("shows where country != Italia group by channel") ==
+              expected([](const show& s) { return string(channelCodes.str(s.channelCode)); },
+                       [&](const show& s) { return country(s) != "Italia"; }),
+          "group by channel within a channel set");
+    check(groups("shows where category = Stiri group by country") ==
+              expected(country, [&](const show& s) { return s.category == news; }),
+          "group by country with a filter");
+}
+
+// Rows come back in the same order whichever access path found them, and a
+// limit keeps the first rows of that order, ties included
+static void rowOrderIgnoresThePlan(const filesystem::path&) {
+    Catalog source;
+    source.insertChannel({"1", "ProTV", "Romania"});
+    source.insertChannel({"2", "Antena", "Romania"});
+    source.insertChannel({"3", "RaiUno", "Italia"});
+    source.insertChannel({"4", "RaiDue", "Italia"});
+    CategoryId news = categoryNames.intern("Stiri");
+    ChannelCodeId codes[] = {channelCodes.intern("1"), channelCodes.intern("2"), channelCodes.intern("3"),
+                             channelCodes.intern("4")};
+    for (int i = 0; i < 40; ++i) {
+        show s{"R" + to_string(i), news, codes[i % 4], 30 + i % 4 * 10, static_cast<uint8_t>(23 - i % 24), 0,
+               static_cast<Day>(i % 2)};
+        source.insertShow(s);
+    }
+
+    auto rows = [&](const string& text, const string& access = "access:") {
+        QueryPlan plan;
+        string error;
+        vector<ShowId> found;
+        if (!compileQuery(text, source, plan, error)) return found;
+        check(plan.notes.front().starts_with(access), text + " plans \"" + access + "\"");
+        for (ShowId id : runQuery(plan, source).rows) found.push_back(id);
+        return found;
+    };
+    auto expected = [&](auto keep, size_t limit) {
+        vector<ShowId> ids;
+        for (const auto& s : source.shows()) {
+            if (keep(s) && ids.size() < limit) ids.push_back(source.findShow(s.name));
+        }
+        return ids;
+    };
+    auto monday = [](const show& s) { return s.dayOfWeek == Day::Monday; };
+    auto romanian = [&](const show& s) { return s.channelCode == codes[0] || s.channelCode == codes[1]; };
+
+    check(rows("shows where day = Luni", "access: day index") == expected(monday, SIZE_MAX),
+          "day index rows in id order");
+    check(rows("shows where day = Luni limit 5", "access: day index") == expected(monday, 5),
+          "day index limit keeps the first ids");
+    check(rows("shows where country = Romania", "access: channel index") == expected(romanian, SIZE_MAX),
+          "channel index rows in id order");
+    check(rows("shows where country = Romania limit 5", "access: channel index") == expected(romanian, 5),
+          "channel index limit keeps the first ids");
+    for (const char* order : {"order by day", "order by duration desc", "order by channel"}) {
+        vector<ShowId> all = rows(string("shows ") + order);
+        all.resize(7);
+        check(rows(string("shows ") + order + " limit 7") == all, string(order) + " breaks ties the same with a limit");
+    }
+    vector<ShowId> byDay = rows("shows order by day");
+    check(ranges::is_sorted(byDay.begin(), byDay.begin() + 20), "order by day breaks ties by id");
+}
+
+// A journal that cannot be written reports it, and a batch is then not applied
+static void journalFailuresAreReported(const filesystem::path& dir) {
+    auto missing = dir / "missing";
+    Journal log((missing / "Catalog.journal").string(), (missing / "Program.txt").string(),
+                (missing / "Channel.txt").string());
+    Catalog target;
+    target.insertChannel({"1", "ProTV", "Romania"});
+    show added {"D", categoryNames.intern("Stiri"), channelCodes.intern("1"), 30, 13, 0, Day::Monday};
+    check(!log.logInsertShow(added), "a record the journal could not take is reported");
+
+    CatalogBatch batch;
+    batch.insertShow(added);
+    vector<string> errors;
+    check(!batch.commit(target, log, errors) && errors.size() == 1, "the batch reports the failed write");
+    check(!target.hasShow("D"), "the failed batch leaves the catalog as it was");
+}
+
+// A write that fails part way, or a crash that tore the last line, must not
+// swallow the next record, and the failed record must not come back on replay
+static void tornJournalWritesAreCut(const filesystem::path& dir) {
+    auto journal = dir / "Catalog.journal";
+    show a {"A", categoryNames.intern("Stiri"), channelCodes.intern("1"), 30, 10, 0, Day::Monday};
+    show b = a, c = a, d = a;
+    b.name = "B";
+    c.name = "C";
+    d.name = "D";
+    {
+        Journal log(journal.string(), (dir / "Program.txt").string(), (dir / "Channel.txt").string());
+        check(log.logInsertShow(a), "the first record is written");
+#ifndef _WIN32
+        // Lets only a few bytes of the next record reach the file
+        signal(SIGXFSZ, SIG_IGN);
+        rlimit old;
+        getrlimit(RLIMIT_FSIZE, &old);
+        rlimit small = old;
+        small.rlim_cur = filesystem::file_size(journal) + 5;
+        setrlimit(RLIMIT_FSIZE, &small);
+        check(!log.logInsertShow(b), "a record cut short is reported");
+        setrlimit(RLIMIT_FSIZE, &old);
+        signal(SIGXFSZ, SIG_DFL);
+#endif
+        check(log.logInsertShow(c), "the record after it is written");
+    }
+    ofstream(journal, ios::binary | ios::app) << "+S Torn Sti";
+    {
+        Journal log(journal.string(), (dir / "Program.txt").string(), (dir / "Channel.txt").string());
+        check(log.logInsertShow(d), "a record after a torn line is written");
+    }
+
+    Catalog replayed;
+    replayed.insertChannel({"1", "ProTV", "Romania"});
+    Journal log(journal.string(), (dir / "Program.txt").string(), (dir / "Channel.txt").string());
+    size_t skipped;
+    check(log.replay(replayed, skipped) == 3 && skipped == 1, "replay applies every good record");
+    check(replayed.hasShow("A") && !replayed.hasShow("B") && replayed.hasShow("C") && replayed.hasShow("D"),
+          "replay has exactly the records reported as written");
+}
+
+// Pieces asking for more than max_align_t's alignment still get it
+static void arenaHonoursLargeAlignments(const filesystem::path&) {
+    for (bool enabled : {true, false}) {
+        setArenasEnabled(enabled);
+        Arena arena(64, 256);
+        for (size_t alignment : {size_t(1), size_t(16), size_t(64), size_t(256), size_t(4096)}) {
+            for (size_t bytes : {size_t(1), size_t(40), size_t(300), size_t(70000)}) {
+                void* p = arena.allocate(bytes, alignment);
+                memset(p, 0xab, bytes);
+                check(reinterpret_cast<uintptr_t>(p) % alignment == 0,
+                      to_string(bytes) + " bytes aligned to " + to_string(alignment) +
+                          (enabled ? "" : " with arenas disabled"));
+                arena.deallocate(p, bytes, alignment);
+            }
+        }
+    }
+    setArenasEnabled(true);
+}
+
+// Writes the metrics when its thread exits, after the thread's own metrics
+// slot is gone, as the dump at program exit does
+struct DumpAtExit {
+    filesystem::path path;
+    ~DumpAtExit() {
+        if (path.empty()) return;
+        string json;
+        metricsTable(collectMetrics()).render(TableFormat::Json, json);
+        writeFileAtomically(path.string(), json);
+    }
+};
+
+static thread_local DumpAtExit dumpAtExit;
+
+// A dump running after the thread's metrics are torn down still writes the
+// file, and its own timed write must not touch the freed counters
+static void metricsDumpAtExit(const filesystem::path& dir) {
+    auto path = dir / "metrics.json";
+    thread([&] {
+        dumpAtExit.path = path;     // constructed first, so destroyed after the metrics slot
+        OpTimer timer(Op::Report);
+    }).join();
+    check(!PRACTICA_METRICS || readText(path).find("report") != string::npos,
+          "the dump at exit lists the thread's calls");
+}
+
+int main() {
+    const pair<const char*, function<void(const filesystem::path&)>> tests[] = {
+        {"rejected lines survive compaction", rejectedLinesSurviveCompaction},
+        {"start times are parsed whole", startTimesAreParsedWhole},
+        {"grouped queries match the shows", groupedQueriesMatchTheShows},
+        {"row order ignores the plan", rowOrderIgnoresThePlan},
+        {"journal failures are reported", journalFailuresAreReported},
+        {"torn journal writes are cut", tornJournalWritesAreCut},
+        {"arena honours large alignments", arenaHonoursLargeAlignments},
+        {"metrics dump at exit", metricsDumpAtExit},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        auto dir = filesystem::temp_directory_path() / "practica-test";
+        filesystem::remove_all(dir);
+        filesystem::create_directories(dir);
+        int before = failures;
+        cout << name << endl;
+        test(dir);
+        if (failures != before) failed++;
+        filesystem::remove_all(dir);
+    }
+    cout << (failed == 0 ? "all tests passed" : to_string(failed) + " test(s) failed") << endl;
+    return failed;
+}
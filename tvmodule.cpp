@@ -1,16 +1,41 @@
 #include "tvmodule.h"
+#include "snapshot.h"
+#include "broadcast.h"
+#include "conflicts.h"
+#include "batch.h"
+#include "loader.h"
+#include "query.h"
+#include "metrics.h"
+#include "arena.h"
 #include <iostream>
 #include <fstream>
 #include <algorithm>
-#include <map>
 #include <iomanip>
 #include <filesystem>
+#include <charconv>
+#include <climits>
+#include <sstream>
+#include <tuple>
 
 using namespace std;
 
-// Define global containers
-vector<show> programs;
-vector<channel> channels;
+// Define global catalog and the journal recording changes to it
+Catalog catalog;
+Journal journal("Catalog.journal", "Program.txt", "Channel.txt");
+
+// Folds the journal into Program.txt/Channel.txt once it grows past its threshold
+static void compactJournalIfNeeded() {
+    if (journal.needsCompaction() && !journal.compact(catalog)) {
+        cout << "Warning: could not compact the journal into Program.txt/Channel.txt." << endl;
+    }
+}
+
+// Changes are logged before they are made, so one the journal could not take
+// is not made at all
+static bool journalFailed() {
+    cout << "Error: could not write the change to Catalog.journal. Nothing was changed." << endl;
+    return false;
+}
 
 // Function to clear the screen (cross-platform)
 void clearScreen() {
@@ -33,6 +58,54 @@ static string decode(const string& s) {
     return r;
 }
 
+static string describeShow(const show& s) {
+    return "\"" + decode(s.name) + "\" (" + dayName(s.dayOfWeek) + " " + formatStartTime(s.startHour, s.startMinute) +
+           ", " + to_string(s.duration) + " min, channel " + channelCodes.str(s.channelCode) + ")";
+}
+
+// Prints the shows that s would overlap on its channel; true if there are any
+static bool reportConflicts(const show& s, ShowId ignore = noShow) {
+    vector<ShowId> overlapping = conflictingShows(catalog, s, ignore);
+    for (ShowId id : overlapping) {
+        cout << "Error: Time slot overlaps " << describeShow(catalog.getShow(id)) << "." << endl;
+    }
+    return !overlapping.empty();
+}
+
+// Columns of the show listings; the day column is left out where all rows share it
+static Table showTable(bool withDay) {
+    vector<TableColumn> columns = {{"Name", "name"}, {"Category", "category"}, {"Start Time", "startTime"},
+                                   {"Duration", "duration", " min", true}};
+    if (withDay) columns.push_back({"Day", "day"});
+    columns.push_back({"Channel Code", "channelCode"});
+    return Table(move(columns));
+}
+
+static void addShowRow(Table& table, const show& s, bool withDay) {
+    table.decodedCell(s.name)
+         .decodedCell(categoryNames.str(s.category))
+         .time(s.startHour, s.startMinute)
+         .number(s.duration);
+    if (withDay) table.cell(dayName(s.dayOfWeek));
+    table.cell(channelCodes.str(s.channelCode));
+}
+
+static Table channelTable() {
+    return Table({{"Code", "code"}, {"Name", "name"}, {"Country of Origin", "originCountry"}});
+}
+
+static void addChannelRow(Table& table, const channel& c) {
+    table.cell(c.code).decodedCell(c.name).decodedCell(c.originCountry);
+}
+
+// Text listings get a title line before the table and a count after it;
+// CSV and JSON are just the rows
+static void printShowTable(const Table& table, TableFormat format, const string& title) {
+    if (format == TableFormat::Text) cout << endl << title;
+    table.print(format);
+    if (format == TableFormat::Text) cout << table.rows() << " shows found." << endl;
+}
+
 bool fileExists(const string& fileName) {
     ifstream file(fileName);
     return file.good();
@@ -47,153 +120,155 @@ void createFileIfNotExists(const string& fileName) {
 }
 
 string generateNextChannelId() {
-    int maxId = 0;
-    
-    // Find the highest existing ID
-    for (const auto& c : channels) {
-        try {
-            int currentId = stoi(c.code);
-            maxId = max(maxId, currentId);
-        } catch (const invalid_argument&) {
-            // Skip non-numeric IDs
-        } catch (const out_of_range&) {
-            // Skip IDs that are too large
-        }
-    }
-    
-    // Return next ID as string
-    return to_string(maxId + 1);
+    // The catalog tracks the highest numeric code, so this is O(1)
+    return to_string(catalog.maxNumericChannelCode() + 1);
 }
 
-void allShows() {
-    if (programs.empty()) {
+void allShows(TableFormat format) {
+    OpTimer timer(Op::Listing);
+    if (catalog.showCount() == 0 && format == TableFormat::Text) {
         cout << "No shows available." << endl;
         return;
     }
 
-    // First pass: determine needed column widths based on content
-    int nameWidth = 4;      // minimum width for "Name"
-    int categoryWidth = 8;  // minimum width for "Category"
-    int timeWidth = 10;     // minimum width for "Start Time"
-    int durationWidth = 8;  // minimum width for "Duration"
-    int dayWidth = 3;       // minimum width for "Day"
-    int channelWidth = 12;  // minimum width for "Channel Code"
-
-    // Determine maximum content width for each column
-    for (const auto& s : programs) {
-        nameWidth = max(nameWidth, static_cast<int>(decode(s.name).length()));
-        categoryWidth = max(categoryWidth, static_cast<int>(decode(s.category).length()));
-        dayWidth = max(dayWidth, static_cast<int>(decode(s.dayOfWeek).length()));
-        channelWidth = max(channelWidth, static_cast<int>(s.channelCode.length()));
-
-        // Calculate duration string length and consider it for column width
-        string durationStr = to_string(s.duration) + " min";
-        durationWidth = max(durationWidth, static_cast<int>(durationStr.length()));
-
-        // Calculate time string length
-        string startTime = (s.startHour < 10 ? "0" + to_string(s.startHour) : to_string(s.startHour)) + ":" +
-                          (s.startMinute < 10 ? "0" + to_string(s.startMinute) : to_string(s.startMinute));
-        timeWidth = max(timeWidth, static_cast<int>(startTime.length()));
-    }
-
-    // Add padding (1 space on each side)
-    nameWidth += 2;
-    categoryWidth += 2;
-    timeWidth += 2;
-    durationWidth += 2;
-    dayWidth += 2;
-    channelWidth += 2;
-
-    // Print header
-    int totalWidth = nameWidth + categoryWidth + timeWidth + durationWidth + dayWidth + channelWidth + 7; // 7 for the separators
+    Table table = showTable(true);
+    table.reserve(catalog.showCount());
+    for (const auto& s : catalog.shows()) {
+        addShowRow(table, s, true);
+    }
+    printShowTable(table, format, "");
+}
 
-    cout << endl << string(totalWidth, '-') << endl;
-    cout << "|" << setw(nameWidth) << left << " Name"
-         << "|" << setw(categoryWidth) << " Category"
-         << "|" << setw(timeWidth) << " Start Time"
-         << "|" << setw(durationWidth) << " Duration"
-         << "|" << setw(dayWidth) << " Day"
-         << "|" << setw(channelWidth) << " Channel Code" << "|" << endl;
-    cout << string(totalWidth, '-') << endl;
+void allChannels(TableFormat format) {
+    OpTimer timer(Op::Listing);
+    if (catalog.channelCount() == 0 && format == TableFormat::Text) {
+        cout << "No channels available." << endl;
+        return;
+    }
 
-    // Print data rows
-    for (const auto& s : programs) {
-        string name = decode(s.name);
-        string category = decode(s.category);
-        string day = decode(s.dayOfWeek);
-        string channelCode = s.channelCode;
-        string startTime = (s.startHour < 10 ? "0" + to_string(s.startHour) : to_string(s.startHour)) + ":" +
-                         (s.startMinute < 10 ? "0" + to_string(s.startMinute) : to_string(s.startMinute));
-        string durationStr = to_string(s.duration) + " min";
+    Table table = channelTable();
+    table.reserve(catalog.channelCount());
+    for (const auto& c : catalog.channels()) {
+        addChannelRow(table, c);
+    }
+    table.print(format);
+    if (format == TableFormat::Text) cout << table.rows() << " channels found." << endl;
+}
 
-        cout << "|" << setw(nameWidth) << " " + name
-             << "|" << setw(categoryWidth) << " " + category
-             << "|" << setw(timeWidth) << " " + startTime
-             << "|" << setw(durationWidth) << " " + durationStr
-             << "|" << setw(dayWidth) << " " + day
-             << "|" << setw(channelWidth) << " " + channelCode << "|" << endl;
+// Adds up to count rows starting at the first live row at or after cursor,
+// and moves cursor past them. Only the rows on the page are visited.
+template <typename Rows, typename AddRow>
+static void fillPage(Table& table, Rows rows, uint32_t& cursor, size_t count, AddRow addRow) {
+    auto it = rows.from(cursor);
+    for (size_t n = 0; n < count && it != rows.end(); ++n, ++it) {
+        addRow(table, *it);
     }
+    cursor = it.id();
+}
 
-    cout << string(totalWidth, '-') << endl;
-    cout << programs.size() << " shows found." << endl;
+static void addShowRowWithDay(Table& table, const show& s) {
+    addShowRow(table, s, true);
 }
 
-void allChannels() {
-    if (channels.empty()) {
-        cout << "No channels available." << endl;
-        return;
+static void printPageFooter(size_t first, size_t rows, size_t total, const char* what) {
+    if (rows == 0) {
+        cout << "No " << what << " on this page (" << total << " in total)." << endl;
+    } else {
+        cout << "Showing " << first + 1 << "-" << first + rows << " of " << total << " " << what << "." << endl;
     }
+}
 
-    // First pass: determine needed column widths based on content
-    int codeWidth = 4;      // minimum width for "Code"
-    int nameWidth = 4;      // minimum width for "Name"
-    int countryWidth = 17;   // minimum width for "Country"
+void showsPage(size_t offset, size_t pageSize, TableFormat format) {
+    OpTimer timer(Op::Listing);
+    Table table = showTable(true);
+    table.reserve(pageSize);
+    ShowId first = catalog.showAtOffset(offset);
+    if (first != noShow) fillPage(table, catalog.shows(), first, pageSize, addShowRowWithDay);
+    table.print(format);
+    if (format == TableFormat::Text) printPageFooter(offset, table.rows(), catalog.showCount(), "shows");
+}
 
-    // Determine maximum content width for each column
-    for (const auto& c : channels) {
-        codeWidth = max(codeWidth, static_cast<int>(c.code.length()) + 1);
-        nameWidth = max(nameWidth, static_cast<int>(c.name.length()) + 1);
-        countryWidth = max(countryWidth, static_cast<int>(c.originCountry.length()) + 1);
+void channelsPage(size_t offset, size_t pageSize, TableFormat format) {
+    OpTimer timer(Op::Listing);
+    Table table = channelTable();
+    table.reserve(pageSize);
+    ChannelId first = catalog.channelAtOffset(offset);
+    if (first != noChannel) fillPage(table, catalog.channels(), first, pageSize, addChannelRow);
+    table.print(format);
+    if (format == TableFormat::Text) printPageFooter(offset, table.rows(), catalog.channelCount(), "channels");
+}
+
+// Pages through a table with a prompt in between. Column widths are sampled
+// from the first page and kept, so the pages line up.
+template <typename Rows, typename AddRow>
+static void browse(Rows rows, size_t total, size_t pageSize, Table (*makeTable)(), AddRow addRow,
+                   const char* what) {
+    uint32_t cursor = 0;
+    size_t shown = 0;
+    vector<size_t> widths;
+    while (true) {
+        Table table = makeTable();
+        if (!widths.empty()) table.fixWidths(widths);
+        table.reserve(pageSize);
+        fillPage(table, rows, cursor, pageSize, addRow);
+        if (widths.empty()) widths = table.columnWidths();
+
+        table.print(TableFormat::Text);
+        printPageFooter(shown, table.rows(), total, what);
+        shown += table.rows();
+        if (rows.from(cursor) == rows.end()) break;
+
+        cout << "Press Enter for the next page, or q to stop: ";
+        string answer;
+        if (!getline(cin, answer) || answer == "q" || answer == "Q") break;
     }
+}
 
-    // Print header
-    int totalWidth = codeWidth + nameWidth + countryWidth + (3 * 3) + 1;
-    cout << string(totalWidth, '-') << endl;
-    cout << "| " << left << setw(codeWidth) << "Code"
-         << " | " << setw(nameWidth) << "Name"
-         << " | " << setw(countryWidth) << "Country of Origin" << " |" << endl;
-    cout << string(totalWidth, '-') << endl;
+static Table showTableWithDay() {
+    return showTable(true);
+}
 
-    // And update the data rows to match:
-    for (const auto& c : channels) {
-        cout << "| " << setw(codeWidth) << c.code
-             << " | " << setw(nameWidth) << decode(c.name)
-             << " | " << setw(countryWidth) << decode(c.originCountry) << " |" << endl;
+void browseShows(size_t pageSize) {
+    if (catalog.showCount() == 0) {
+        cout << "No shows available." << endl;
+        return;
     }
+    cout << endl;
+    browse(catalog.shows(), catalog.showCount(), pageSize, showTableWithDay, addShowRowWithDay, "shows");
+}
 
-    cout << string(totalWidth, '-') << endl;
-    cout << channels.size() << " channels found." << endl;
+void browseChannels(size_t pageSize) {
+    if (catalog.channelCount() == 0) {
+        cout << "No channels available." << endl;
+        return;
+    }
+    browse(catalog.channels(), catalog.channelCount(), pageSize, channelTable, addChannelRow, "channels");
 }
 
-void addShow(const string& name, const string& category, const string& startTime, int duration, const string& dayOfWeek, string channelCode) {
+bool addShow(const string& name, const string& category, const string& startTime, int duration, const string& dayOfWeek, string channelCode) {
+    OpTimer timer(Op::AddShow);
     if (name.empty() || category.empty() || startTime.empty() || duration <= 0 || dayOfWeek.empty() || channelCode.empty()) {
         cout << "Invalid input. Please provide valid show details." << endl;
-        return;
+        return false;
     }
 
     string encName = encode(name);
     string encCategory = encode(category);
-    string encDay = encode(dayOfWeek);
 
-    if (ranges::any_of(programs, [&encName](const show& s) { return s.name == encName; })) {
+    if (catalog.hasShow(encName)) {
         cout << "Show with this name already exists." << endl;
-        return;
+        return false;
     }
 
-    bool channelExists = ranges::any_of(channels, [&channelCode](const channel& c) { return c.code == channelCode; });
-    if (!channelExists) {
+    Day day;
+    if (!parseDay(dayOfWeek, day)) {
+        cout << "Invalid day of week. Use Luni, Marti, Miercuri, Joi, Vineri, Sambata or Duminica." << endl;
+        return false;
+    }
+
+    if (!catalog.hasChannelCode(channelCode)) {
         cout << "Error: Channel code does not exist. Please enter a valid channel code." << endl;
-        return;
+        return false;
     }
 
     int startHour = 0, startMinute = 0;
@@ -206,47 +281,47 @@ void addShow(const string& name, const string& category, const string& startTime
             // Validate time ranges
             if (startHour < 0 || startHour > 23 || startMinute < 0 || startMinute > 59) {
                 cout << "Invalid time. Hours must be 0-23, minutes must be 0-59." << endl;
-                return; // or set to default values
+                return false; // or set to default values
             }
         } catch (const exception& e) {
             cout << "Invalid time format: " << e.what() << endl;
-            return; // or set to default values
+            return false; // or set to default values
         }
     }
 
     show s;
     s.name = encName;
-    s.category = encCategory;
-    s.startHour = startHour;
-    s.startMinute = startMinute;
+    s.category = categoryNames.intern(encCategory);
+    s.channelCode = channelCodes.intern(channelCode);
     s.duration = duration;
-    s.dayOfWeek = encDay;
-    s.channelCode = channelCode;
-    programs.push_back(s);
-
-    createFileIfNotExists("Program.txt");
-    ofstream o("Program.txt", ios::app);
-    o << s.name << ' ' << s.category << ' '
-      << (s.startHour < 10 ? "0" : "") << s.startHour << ':'
-      << (s.startMinute < 10 ? "0" : "") << s.startMinute << ' '
-      << s.duration << ' ' << s.dayOfWeek << ' ' << s.channelCode << endl;
-    o.close();
+    s.startHour = static_cast<uint8_t>(startHour);
+    s.startMinute = static_cast<uint8_t>(startMinute);
+    s.dayOfWeek = day;
+    if (reportConflicts(s)) {
+        cout << "Show not added." << endl;
+        return false;
+    }
+    if (!journal.logInsertShow(s)) return journalFailed();
+    catalog.insertShow(s);
+    compactJournalIfNeeded();
 
     cout << "Show added successfully." << endl;
+    return true;
 }
 
-void addChannel(const string& name, const string& originCountry) {
+bool addChannel(const string& name, const string& originCountry) {
+    OpTimer timer(Op::AddChannel);
     if (name.empty() || originCountry.empty()) {
         cout << "Invalid input. Please provide valid channel details." << endl;
-        return;
+        return false;
     }
 
     string encName = encode(name);
     string encCountry = encode(originCountry);
 
-    if (ranges::any_of(channels, [&encName](const channel& c) { return c.name == encName; })) {
+    if (catalog.hasChannelName(encName)) {
         cout << "Channel with this name already exists." << endl;
-        return;
+        return false;
     }
 
     string code = generateNextChannelId();
@@ -255,76 +330,78 @@ void addChannel(const string& name, const string& originCountry) {
     c.code = code;
     c.name = encName;
     c.originCountry = encCountry;
-    channels.push_back(c);
-
-    createFileIfNotExists("Channel.txt");
-    ofstream o("Channel.txt", ios::app);
-    o << c.code << ' ' << c.name << ' ' << c.originCountry << endl;
-    o.close();
+    if (!journal.logInsertChannel(c)) return journalFailed();
+    catalog.insertChannel(c);
+    compactJournalIfNeeded();
     
     cout << "Channel added successfully with ID: " << code << endl;
+    return true;
 }
 
-void deleteShow(const string& name) {
+bool deleteShow(const string& name) {
+    OpTimer timer(Op::DeleteShow);
     if (name.empty()) {
         cout << "Invalid input. Please provide valid show details." << endl;
-        return;
+        return false;
     }
 
     string encName = encode(name);
-    auto it = ranges::remove_if(programs, [&encName](const show& s) { return s.name == encName; }).begin();
-    if (it != programs.end()) {
-        programs.erase(it, programs.end());
-        cout << "Show deleted successfully." << endl;
-    } else {
+    ShowId id = catalog.findShow(encName);
+    if (id == noShow) {
         cout << "Show not found." << endl;
+        return false;
     }
-    if (!fileExists("Program.txt")) {
-        cout << "File not found. Cannot update." << endl;
-        return;
-    }
-    ofstream o("Program.txt");
-    for (const auto& s : programs) {
-        string startTimeStr = (s.startHour < 10 ? "0" + to_string(s.startHour) : to_string(s.startHour)) + ":" +
-                              (s.startMinute < 10 ? "0" + to_string(s.startMinute) : to_string(s.startMinute));
-        o << s.name << " " << s.category << " " << startTimeStr << " " << s.duration << " " << s.dayOfWeek << " " << s.channelCode << endl;
-    }
+    if (!journal.logDeleteShow(encName)) return journalFailed();
+    catalog.eraseShow(id);
+    compactJournalIfNeeded();
+    cout << "Show deleted successfully." << endl;
+    return true;
 }
 
-void deleteChannel(const string& name) {
+bool deleteChannel(const string& name, bool cascade) {
+    OpTimer timer(Op::DeleteChannel);
     if (name.empty()) {
-        cout << "Invalid input. Please provide valid show details." << endl;
-        return;
+        cout << "Invalid input. Please provide valid channel details." << endl;
+        return false;
     }
 
     string encName = encode(name);
-    auto it = ranges::remove_if(channels, [&encName](const channel& c) { return c.name == encName; }).begin();
-    if (it != channels.end()) {
-        channels.erase(it, channels.end());
-        cout << "Channel deleted successfully." << endl;
-    } else {
+    ChannelId id = catalog.findChannelByName(encName);
+    if (id == noChannel) {
         cout << "Channel not found." << endl;
+        return false;
     }
-    if (!fileExists("Channel.txt")) {
-        cout << "File not found. Cannot update." << endl;
-        return;
+    string code = catalog.getChannel(id).code;
+    size_t dependents = catalog.showsOnChannel(channelCodes.find(code)).size();
+    if (dependents > 0 && !cascade) {
+        cout << "Error: The channel still has " << dependents << " shows. Delete them first, or delete the channel "
+             << "together with its shows." << endl;
+        return false;
     }
-    ofstream o("Channel.txt");
-    for (const auto& c : channels) {
-        o << c.code << " " << c.name << " " << c.originCountry << endl;
+    // Replaying the record erases the shows again, so they need no records of their own
+    if (!journal.logDeleteChannel(code)) return journalFailed();
+    catalog.eraseChannel(id, ChannelErase::Cascade);
+    compactJournalIfNeeded();
+    if (dependents > 0) {
+        cout << "Channel and its " << dependents << " shows deleted successfully." << endl;
+    } else {
+        cout << "Channel deleted successfully." << endl;
     }
+    return true;
 }
 
-void editShow(const string& name, string newName, string newCategory, string newStartTime, int newDuration, string newDayOfWeek, string newChannelCode) {
+bool editShow(const string& name, string newName, string newCategory, string newStartTime, int newDuration, string newDayOfWeek, string newChannelCode) {
     if (name.empty()) {
         cout << "Invalid input. Please provide valid show details." << endl;
-        return;
+        return false;
     }
     string encName = encode(name);
 
-    auto it = ranges::find_if(programs, [&encName](const show& s) { return s.name == encName; });
-    if (it != programs.end()) {
-        cout << "Editing show: " << decode(it->name) << endl;
+    ShowId id = catalog.findShow(encName);
+    if (id != noShow) {
+        // Edit a copy so the catalog indexes only ever see the finished record
+        show edited = catalog.getShow(id);
+        cout << "Editing show: " << decode(edited.name) << endl;
 
         if (newName.empty() || newCategory.empty() || newStartTime.empty() ||
             newDuration == 0 || newDayOfWeek.empty() || newChannelCode.empty()) {
@@ -335,22 +412,20 @@ void editShow(const string& name, string newName, string newCategory, string new
             cout << "Name: ";
             getline(cin, newName);
             newName = encode(newName);
-            if (!newName.empty() && ranges::any_of(programs, [&](const show& s) {
-                return s.name == newName && s.name != name; })) {
+            if (!newName.empty() && newName != encName && catalog.hasShow(newName)) {
                 cout << "Show with this name already exists." << endl;
-                return;
+                return false;
             }
             if (!newName.empty()) {
-                it->name = move(newName);
+                edited.name = move(newName);
             }
         } else {
             newName = encode(newName);
-            if (ranges::any_of(programs, [&](const show& s) {
-                return s.name == newName && s.name != name; })) {
+            if (newName != encName && catalog.hasShow(newName)) {
                 cout << "Show with this name already exists." << endl;
-                return;
+                return false;
             }
-            it->name = move(newName);
+            edited.name = move(newName);
         }
 
         if (newCategory.empty()) {
@@ -358,13 +433,17 @@ void editShow(const string& name, string newName, string newCategory, string new
             getline(cin, newCategory);
             newCategory = encode(newCategory);
             if (!newCategory.empty()) {
-                it->category = move(newCategory);
+                edited.category = categoryNames.intern(newCategory);
             }
         } else {
             newCategory = encode(newCategory);
-            it->category = move(newCategory);
+            edited.category = categoryNames.intern(newCategory);
         }
 
+        // A bad value typed at a prompt keeps the original; one passed in fails the edit
+        bool timeGiven = !newStartTime.empty();
+        bool dayGiven = !newDayOfWeek.empty();
+        bool badTime = false;
         if (newStartTime.empty()) {
             cout << "Start Time (HH:MM): ";
             getline(cin, newStartTime);
@@ -385,18 +464,25 @@ void editShow(const string& name, string newName, string newCategory, string new
 
                     // Validate the time
                     if (hour >= 0 && hour <= 23 && minute >= 0 && minute <= 59) {
-                        it->startHour = hour;
-                        it->startMinute = minute;
+                        edited.startHour = hour;
+                        edited.startMinute = minute;
                     } else {
                         cout << "Invalid time values. Hours must be 0-23, minutes 0-59." << endl;
+                        badTime = true;
                     }
                 } else {
                     cout << "Invalid time format. Use HH:MM format." << endl;
+                    badTime = true;
                 }
             } catch (const exception& e) {
                 cout << "Error parsing time: " << e.what() << ". Using original time." << endl;
+                badTime = true;
             }
         }
+        if (badTime && timeGiven) {
+            cout << "Show not updated." << endl;
+            return false;
+        }
 
         if (!newDuration) {
             cout << "Duration: ";
@@ -409,24 +495,27 @@ void editShow(const string& name, string newName, string newCategory, string new
                     if (newDuration <= 0) {
                         cout << "Invalid duration. Please provide a positive value." << endl;
                     } else {
-                        it->duration = newDuration;
+                        edited.duration = newDuration;
                     }
                 } catch (const exception& e) {
                     cout << "Error parsing duration: " << e.what() << endl;
                 }
             }
         } else {
-            it->duration = newDuration;
+            edited.duration = newDuration;
         }
 
         if (newDayOfWeek.empty()) {
             cout << "Day of Week: ";
             getline(cin, newDayOfWeek);
-            if (!newDayOfWeek.empty()) {
-                it->dayOfWeek = move(newDayOfWeek);
+        }
+
+        if (!newDayOfWeek.empty() && !parseDay(newDayOfWeek, edited.dayOfWeek)) {
+            if (dayGiven) {
+                cout << "Invalid day of week. Show not updated." << endl;
+                return false;
             }
-        } else {
-            it->dayOfWeek = move(newDayOfWeek);
+            cout << "Invalid day of week. Using original day." << endl;
         }
 
         if (newChannelCode.empty()) {
@@ -434,53 +523,49 @@ void editShow(const string& name, string newName, string newCategory, string new
             getline(cin, newChannelCode);
             if (!newChannelCode.empty()) {
                 // Check if channel code exists
-                bool channelExists = ranges::any_of(channels,
-                                                    [&newChannelCode](const channel& c) { return c.code == newChannelCode; });
-                if (!channelExists) {
+                if (!catalog.hasChannelCode(newChannelCode)) {
                     cout << "Error: Channel code does not exist. Channel not updated." << endl;
-                    return;
+                    return false;
                 }
-                it->channelCode = move(newChannelCode);
+                edited.channelCode = channelCodes.intern(newChannelCode);
             }
         } else {
             // Check if channel code exists
-            bool channelExists = ranges::any_of(channels,
-                                                [&newChannelCode](const channel& c) { return c.code == newChannelCode; });
-            if (!channelExists) {
+            if (!catalog.hasChannelCode(newChannelCode)) {
                 cout << "Error: Channel code does not exist. Channel not updated." << endl;
-                return;
+                return false;
             }
-            it->channelCode = move(newChannelCode);
+            edited.channelCode = channelCodes.intern(newChannelCode);
         }
 
-        if (!fileExists("Program.txt")) {
-            cout << "File not found. Cannot update." << endl;
-            return;
-        }
-        ofstream o("Program.txt");
-        for (const auto& s : programs) {
-            string startTimeStr = (s.startHour < 10 ? "0" + to_string(s.startHour) : to_string(s.startHour)) + ":" +
-                                 (s.startMinute < 10 ? "0" + to_string(s.startMinute) : to_string(s.startMinute));
-            o << s.name << " " << s.category << " " << startTimeStr << " " << s.duration << " " << s.dayOfWeek << " " << s.channelCode << endl;
+        // Timed from here on, so the time spent at the prompts is left out
+        OpTimer timer(Op::EditShow);
+        if (reportConflicts(edited, id)) {
+            cout << "Show not updated." << endl;
+            return false;
         }
-        o.close();
+        if (!journal.logUpdateShow(encName, edited)) return journalFailed();
+        catalog.updateShow(id, move(edited));
+        compactJournalIfNeeded();
 
         cout << "Show updated successfully." << endl;
-    } else {
-        cout << "Show not found." << endl;
+        return true;
     }
+    cout << "Show not found." << endl;
+    return false;
 }
 
-void editChannel(const string& name, string newName, string newOriginCountry) {
+bool editChannel(const string& name, string newName, string newOriginCountry) {
     if (name.empty()) {
         cout << "Invalid input. Please provide valid channel details." << endl;
-        return;
+        return false;
     }
 
     string encName = encode(name);
-    auto it = ranges::find_if(channels, [&encName](const channel& c) { return c.name == encName; });
-    if (it != channels.end()) {
-        cout << "Editing channel: " << decode(it->name) << endl;
+    ChannelId id = catalog.findChannelByName(encName);
+    if (id != noChannel) {
+        channel edited = catalog.getChannel(id);
+        cout << "Editing channel: " << decode(edited.name) << endl;
 
         if (newName.empty() || newOriginCountry.empty()) {
             cout << "Enter new details (leave blank to keep current value):" << endl;
@@ -490,22 +575,20 @@ void editChannel(const string& name, string newName, string newOriginCountry) {
             cout << "Name: ";
             getline(cin, newName);
             newName = encode(newName);  // Fix: encode newName, not name
-            if (ranges::any_of(channels.begin(), channels.end(), [&](const channel& c) {
-                return c.name == newName && c.name != it->name; })) {
+            if (!newName.empty() && newName != edited.name && catalog.hasChannelName(newName)) {
                 cout << "Channel with this name already exists." << endl;
-                return;
+                return false;
             }
             if (!newName.empty()) {
-                it->name = move(newName);
+                edited.name = move(newName);
             }
         } else {
             newName = encode(newName);
-            if (ranges::any_of(channels, [&newName, &it](const channel& c) { 
-                return c.name == newName && c.name != it->name; })) {
+            if (newName != edited.name && catalog.hasChannelName(newName)) {
                 cout << "Channel with this name already exists." << endl;
-                return;
+                return false;
             }
-            it->name = move(newName);
+            edited.name = move(newName);
         }
 
         if (newOriginCountry.empty()) {
@@ -513,348 +596,440 @@ void editChannel(const string& name, string newName, string newOriginCountry) {
             getline(cin, newOriginCountry);
             if (!newOriginCountry.empty()) {
                 newOriginCountry = encode(newOriginCountry);
-                it->originCountry = move(newOriginCountry);
+                edited.originCountry = move(newOriginCountry);
             }
         } else {
             newOriginCountry = encode(newOriginCountry);
-            it->originCountry = move(newOriginCountry);
+            edited.originCountry = move(newOriginCountry);
         }
 
-        if (!fileExists("Channel.txt")) {
-            cout << "File not found. Cannot update." << endl;
-            return;
-        }
-        ofstream o("Channel.txt");
-        for (const auto& c : channels) {
-            o << c.code << " " << c.name << " " << c.originCountry << endl;
-        }
-        o.close();
+        OpTimer timer(Op::EditChannel);     // leaves out the prompts, as in editShow
+        if (!journal.logUpdateChannel(edited)) return journalFailed();
+        catalog.updateChannel(id, move(edited));
+        compactJournalIfNeeded();
 
         cout << "Channel updated successfully." << endl;
-    } else {
-        cout << "Channel not found." << endl;
+        return true;
     }
+    cout << "Channel not found." << endl;
+    return false;
 }
 
-void broadcastSummary() {
-    if (channels.empty() || programs.empty()) {
+bool broadcastSummary() {
+    OpTimer timer(Op::BroadcastSummary);
+    if (catalog.channelCount() == 0 || catalog.showCount() == 0) {
         cout << "No channels or shows available." << endl;
-        return;
+        return true;
     }
 
-    if (!fileExists("BroadcastSummary.txt")) {
-        createFileIfNotExists("BroadcastSummary.txt");
+    // Shows and minutes per channel, then per country, both sorted by name
+    BroadcastTotals totals = summarizeBroadcasts(catalog);
+    string summary;
+    for (const auto& c : totals.channels) {
+        summary += c.name + " " + to_string(c.shows) + " " + to_string(c.minutes) + "\n";
+    }
+    summary += "\n";
+    for (const auto& c : totals.countries) {
+        summary += c.name + " " + to_string(c.shows) + " " + to_string(c.minutes) + "\n";
     }
-    ofstream o("BroadcastSummary.txt");
 
-    // Map to store channel names and show counts
-    map<string, int> channelCounts;
+    // Written whole or not at all, so a crash never leaves a truncated summary
+    if (!writeFileAtomically("BroadcastSummary.txt", summary)) {
+        cout << "Error: could not write BroadcastSummary.txt." << endl;
+        return false;
+    }
+    cout << "Broadcast summary has been written to BroadcastSummary.txt" << endl;
+    return true;
+}
 
-    // Count shows for each channel
-    for (const auto& show : programs) {
-        // Find the channel name for this show
-        for (const auto& channel : channels) {
-            if (channel.code == show.channelCode) {
-                channelCounts[channel.name]++;
-                break;
-            }
-        }
+bool specificDayShow(const string& day, TableFormat format) {
+    OpTimer timer(Op::Report);
+    // Case-insensitive day matching, done once on the input
+    Day wanted;
+    if (!parseDay(day, wanted)) {
+        cout << "Invalid day of week. Use Luni, Marti, Miercuri, Joi, Vineri, Sambata or Duminica." << endl;
+        return false;
     }
 
-    // Write results to file
-    for (const auto& [channelName, count] : channelCounts) {
-        o << channelName << " " << count << endl;
+    // Already sorted by start time in the catalog's schedule index
+    DaySchedule::Range dayShows = catalog.showsOn(wanted);
+    if (dayShows.empty() && format == TableFormat::Text) {
+        cout << "No shows found for the specified day." << endl;
+        return true;
     }
 
-    o.close();
-    cout << "Broadcast summary has been written to BroadcastSummary.txt" << endl;
+    Table table = showTable(false);
+    table.reserve(dayShows.size());
+    for (ShowId id : dayShows) {
+        addShowRow(table, catalog.getShow(id), false);
+    }
+    printShowTable(table, format, "Shows on " + day + ":\n");
+    return true;
 }
 
-void specificDayShow(const string& day) {
-    vector<show> sortedShows;
-
-    // Convert input day to lowercase
-    string dayLower = day;
-    ranges::transform(dayLower, dayLower.begin(), ::tolower);
+bool channelShows(const string& channelCode, TableFormat format) {
+    OpTimer timer(Op::Report);
+    ChannelId channelId = catalog.findChannelByCode(channelCode);
+    if (channelId == noChannel) {
+        cout << "Channel not found." << endl;
+        return false;
+    }
 
-    // Case-insensitive day matching
-    for (auto &s : programs) {
-        string programDayLower = s.dayOfWeek;
-        ranges::transform(programDayLower, programDayLower.begin(), ::tolower);
+    // Only the channel's own shows, from its list, put in weekly order
+    const PostingList& ids = catalog.showsOnChannel(channelCodes.find(channelCode));
+    vector<ShowId> rows;
+    rows.reserve(ids.size());
+    for (ShowId id : ids) rows.push_back(id);
+    ranges::stable_sort(rows, {}, [](ShowId id) {
+        const show& s = catalog.getShow(id);
+        return minuteOfWeek(s.dayOfWeek, s.startHour, s.startMinute);
+    });
 
-        if (programDayLower == dayLower) {
-            sortedShows.push_back(s);
-        }
+    Table table = showTable(true);
+    table.reserve(rows.size());
+    for (ShowId id : rows) {
+        addShowRow(table, catalog.getShow(id), true);
     }
+    printShowTable(table, format, "Shows on " + decode(catalog.getChannel(channelId).name) + ":\n");
+    return true;
+}
 
-    if (sortedShows.empty()) {
-        cout << "No shows found for the specified day." << endl;
+void maxShow(TableFormat format) {
+    OpTimer timer(Op::Report);
+    if (catalog.showCount() == 0) {
+        cout << "No shows available." << endl;
         return;
     }
 
-    // Sort shows by start time
-    ranges::sort(sortedShows, [](const show& a, const show& b) {
-        if (a.startHour != b.startHour) {
-            return a.startHour < b.startHour;
-        }
-        return a.startMinute < b.startMinute;
-    });
-
-    // First pass: determine needed column widths based on content
-    int nameWidth = 4;      // minimum width for "Name"
-    int categoryWidth = 8;  // minimum width for "Category"
-    int timeWidth = 10;     // minimum width for "Start Time"
-    int durationWidth = 8;  // minimum width for "Duration"
-    int channelWidth = 12;  // minimum width for "Channel Code"
+    // The running aggregates know the maximum and which shows have it
+    const DurationAggregates& durations = catalog.durations();
+    int maxDuration = durations.all().max;
+    Table table = showTable(true);
+    for (ShowId id : durations.withDuration(maxDuration)) {
+        addShowRow(table, catalog.getShow(id), true);
+    }
+    printShowTable(table, format, "Shows with the longest duration (" + to_string(maxDuration) + " minutes):\n");
+}
 
-    // Determine maximum content width for each column
-    for (const auto& s : sortedShows) {
-        nameWidth = max(nameWidth, static_cast<int>(decode(s.name).length()));
-        categoryWidth = max(categoryWidth, static_cast<int>(decode(s.category).length()));
-        channelWidth = max(channelWidth, static_cast<int>(s.channelCode.length()));
+void minShow(TableFormat format) {
+    OpTimer timer(Op::Report);
+    if (catalog.showCount() == 0) {
+        cout << "No shows available." << endl;
+        return;
+    }
 
-        // Calculate duration string length and consider it for column width
-        string durationStr = to_string(s.duration) + " min";
-        durationWidth = max(durationWidth, static_cast<int>(durationStr.length()));
+    // The running aggregates know the minimum and which shows have it
+    const DurationAggregates& durations = catalog.durations();
+    int minDuration = durations.all().min;
+    Table table = showTable(true);
+    for (ShowId id : durations.withDuration(minDuration)) {
+        addShowRow(table, catalog.getShow(id), true);
+    }
+    printShowTable(table, format, "Shows with the shortest duration (" + to_string(minDuration) + " minutes):\n");
+}
 
-        // Calculate time string length
-        string startTime = (s.startHour < 10 ? "0" + to_string(s.startHour) : to_string(s.startHour)) + ":" +
-                          (s.startMinute < 10 ? "0" + to_string(s.startMinute) : to_string(s.startMinute));
-        timeWidth = max(timeWidth, static_cast<int>(startTime.length()));
+void averageShow(const string& category) {
+    OpTimer timer(Op::Report);
+    CategoryId wanted = categoryNames.find(encode(category));
+    DurationStats stats = catalog.durations().category(wanted);
+    if (stats.count == 0) {
+        cout << "No shows available in the " << category << " category." << endl;
+    } else {
+        double average = stats.average();
+        cout << "Average duration of shows in category "  << category << ": " << average << " minutes." << endl;
     }
+}
 
-    // Add padding (1 space on each side)
-    nameWidth += 2;
-    categoryWidth += 2;
-    timeWidth += 2;
-    durationWidth += 2;
-    channelWidth += 2;
+void durationSummary() {
+    OpTimer timer(Op::Report);
+    if (catalog.showCount() == 0) {
+        cout << "No shows available." << endl;
+        return;
+    }
 
-    // Print header
-    int totalWidth = nameWidth + categoryWidth + timeWidth + durationWidth + channelWidth + 6; // 6 for the separators
-    cout << endl << "Shows on " << day << ":" << endl;
-    cout << string(totalWidth, '-') << endl;
-    cout << "|" << setw(nameWidth) << left << " Name"
-         << "|" << setw(categoryWidth) << " Category"
-         << "|" << setw(timeWidth) << " Start Time"
-         << "|" << setw(durationWidth) << " Duration"
-         << "|" << setw(channelWidth) << " Channel Code" << "|" << endl;
-    cout << string(totalWidth, '-') << endl;
+    // Global and per-category statistics are kept up to date by the catalog
+    const DurationAggregates& durations = catalog.durations();
+    DurationStats all = durations.all();
 
-    // Print data rows
-    for (const auto& s : sortedShows) {
-        string name = decode(s.name);
-        string category = decode(s.category);
-        string channelCode = s.channelCode;
-        string startTime = (s.startHour < 10 ? "0" + to_string(s.startHour) : to_string(s.startHour)) + ":" +
-                         (s.startMinute < 10 ? "0" + to_string(s.startMinute) : to_string(s.startMinute));
-        string durationStr = to_string(s.duration) + " min";
+    cout << endl << "Longest show: " << all.max << " minutes" << endl;
+    cout << "Shortest show: " << all.min << " minutes" << endl;
+    cout << "Average duration: " << fixed << setprecision(1) << all.average() << " minutes" << endl;
 
-        cout << "|" << setw(nameWidth) << " " + name
-             << "|" << setw(categoryWidth) << " " + category
-             << "|" << setw(timeWidth) << " " + startTime
-             << "|" << setw(durationWidth) << " " + durationStr
-             << "|" << setw(channelWidth) << " " + channelCode << "|" << endl;
+    int categoryWidth = 8;  // minimum width for "Category"
+    for (CategoryId id = 0; id < durations.categoryCount(); ++id) {
+        if (durations.category(id).count > 0) {
+            categoryWidth = max(categoryWidth, static_cast<int>(categoryNames.str(id).length()));
+        }
     }
+    categoryWidth += 2;
 
+    int totalWidth = categoryWidth + 10 + 14 + 4;
+    cout << endl << string(totalWidth, '-') << endl;
+    cout << "|" << setw(categoryWidth) << left << " Category"
+         << "|" << setw(10) << " Shows"
+         << "|" << setw(14) << " Average" << "|" << endl;
+    cout << string(totalWidth, '-') << endl;
+    for (CategoryId id = 0; id < durations.categoryCount(); ++id) {
+        DurationStats c = durations.category(id);
+        if (c.count == 0) continue;
+        ostringstream average;
+        average << fixed << setprecision(1) << c.average() << " min";
+        cout << "|" << setw(categoryWidth) << " " + decode(categoryNames.str(id))
+             << "|" << setw(10) << " " + to_string(c.count)
+             << "|" << setw(14) << " " + average.str() << "|" << endl;
+    }
     cout << string(totalWidth, '-') << endl;
-    cout << sortedShows.size() << " shows found." << endl;
+    cout << defaultfloat;
 }
 
-void maxShow() {
-    if (programs.empty()) {
-        cout << "No shows available." << endl;
+void operationStats(TableFormat format) {
+    if (!PRACTICA_METRICS) {
+        cout << "Operation metrics were compiled out (PRACTICA_METRICS=0)." << endl;
+        return;
+    }
+    vector<OpMetrics> metrics = collectMetrics();
+    if (metrics.empty() && format == TableFormat::Text) {
+        cout << "No operations recorded yet." << endl;
         return;
     }
+    if (format == TableFormat::Text) cout << endl << "Operations since start-up:" << endl;
+    metricsTable(metrics).print(format);
+}
 
-    int maxDuration = 0;
-    vector<show> longestShows;
+bool whatsOn(const string& day, const string& time, int windowMinutes, const string& channelCode, TableFormat format) {
+    OpTimer timer(Op::Report);
+    Day wanted;
+    if (!parseDay(day, wanted)) {
+        cout << "Invalid day of week. Use Luni, Marti, Miercuri, Joi, Vineri, Sambata or Duminica." << endl;
+        return false;
+    }
 
-    // First, find the maximum duration
-    for (const auto& s : programs) {
-        if (s.duration > maxDuration) {
-            maxDuration = s.duration;
-        }
+    // Each part must be a number and nothing else, so "1x:30" is rejected
+    auto whole = [](const char* first, const char* last, int& number) {
+        auto [end, ec] = from_chars(first, last, number);
+        return ec == errc() && end == last;
+    };
+    int hour = 0, minute = 0;
+    size_t colonPos = min(time.find(':'), time.size());
+    if (!whole(time.data(), time.data() + colonPos, hour) ||
+        (colonPos < time.size() && !whole(time.data() + colonPos + 1, time.data() + time.size(), minute))) {
+        cout << "Invalid time format. Use HH:MM." << endl;
+        return false;
+    }
+    if (hour < 0 || hour > 23 || minute < 0 || minute > 59) {
+        cout << "Invalid time. Hours must be 0-23, minutes must be 0-59." << endl;
+        return false;
+    }
+    if (windowMinutes < 0) {
+        cout << "Invalid window length." << endl;
+        return false;
     }
 
-    // Then collect all shows with that duration
-    for (const auto& s : programs) {
-        if (s.duration == maxDuration) {
-            longestShows.push_back(s);
+    optional<ChannelCodeId> channel;
+    if (!channelCode.empty()) {
+        if (!catalog.hasChannelCode(channelCode)) {
+            cout << "Error: Channel code does not exist." << endl;
+            return false;
         }
+        channel = channelCodes.find(channelCode);
     }
 
-    // First pass: determine needed column widths based on content
-    int nameWidth = 4;      // minimum width for "Name"
-    int categoryWidth = 8;  // minimum width for "Category"
-    int timeWidth = 10;     // minimum width for "Start Time"
-    int durationWidth = 8;  // minimum width for "Duration"
-    int dayWidth = 3;       // minimum width for "Day"
-    int channelWidth = 12;  // minimum width for "Channel Code"
-
-    // Determine maximum content width for each column
-    for (const auto& s : longestShows) {
-        nameWidth = max(nameWidth, static_cast<int>(decode(s.name).length()));
-        categoryWidth = max(categoryWidth, static_cast<int>(decode(s.category).length()));
-        dayWidth = max(dayWidth, static_cast<int>(decode(s.dayOfWeek).length()));
-        channelWidth = max(channelWidth, static_cast<int>(s.channelCode.length()));
-
-        // Calculate duration string length and consider it for column width
-        string durationStr = to_string(s.duration) + " min";
-        durationWidth = max(durationWidth, static_cast<int>(durationStr.length()));
-
-        // Calculate time string length
-        string startTime = (s.startHour < 10 ? "0" + to_string(s.startHour) : to_string(s.startHour)) + ":" +
-                          (s.startMinute < 10 ? "0" + to_string(s.startMinute) : to_string(s.startMinute));
-        timeWidth = max(timeWidth, static_cast<int>(startTime.length()));
-    }
-
-    // Add padding (1 space on each side)
-    nameWidth += 2;
-    categoryWidth += 2;
-    timeWidth += 2;
-    durationWidth += 2;
-    dayWidth += 2;
-    channelWidth += 2;
-
-    // Print header
-    int totalWidth = nameWidth + categoryWidth + timeWidth + durationWidth + dayWidth + channelWidth + 7; // 7 for the separators
-    cout << endl << "Shows with the longest duration (" << maxDuration << " minutes):" << endl;
-    cout << string(totalWidth, '-') << endl;
-    cout << "|" << setw(nameWidth) << left << " Name"
-         << "|" << setw(categoryWidth) << " Category"
-         << "|" << setw(timeWidth) << " Start Time"
-         << "|" << setw(durationWidth) << " Duration"
-         << "|" << setw(dayWidth) << " Day"
-         << "|" << setw(channelWidth) << " Channel Code" << "|" << endl;
-    cout << string(totalWidth, '-') << endl;
+    vector<ShowId> airing;
+    catalog.showsAiringDuring(minuteOfWeek(wanted, hour, minute), windowMinutes, airing, channel);
+    if (airing.empty() && format == TableFormat::Text) {
+        cout << "Nothing is on the air then." << endl;
+        return true;
+    }
 
-    // Print data rows
-    for (const auto& s : longestShows) {
-        string name = decode(s.name);
-        string category = decode(s.category);
-        string day = decode(s.dayOfWeek);
-        string channelCode = s.channelCode;
-        string startTime = (s.startHour < 10 ? "0" + to_string(s.startHour) : to_string(s.startHour)) + ":" +
-                         (s.startMinute < 10 ? "0" + to_string(s.startMinute) : to_string(s.startMinute));
-        string durationStr = to_string(s.duration) + " min";
+    // Order by start time, then channel
+    ranges::sort(airing, [](ShowId a, ShowId b) {
+        const show& x = catalog.getShow(a);
+        const show& y = catalog.getShow(b);
+        return tuple(x.dayOfWeek, x.startHour, x.startMinute, channelCodes.str(x.channelCode)) <
+               tuple(y.dayOfWeek, y.startHour, y.startMinute, channelCodes.str(y.channelCode));
+    });
 
-        cout << "|" << setw(nameWidth) << " " + name
-             << "|" << setw(categoryWidth) << " " + category
-             << "|" << setw(timeWidth) << " " + startTime
-             << "|" << setw(durationWidth) << " " + durationStr
-             << "|" << setw(dayWidth) << " " + day
-             << "|" << setw(channelWidth) << " " + channelCode << "|" << endl;
+    Table table = showTable(true);
+    table.reserve(airing.size());
+    for (ShowId id : airing) {
+        addShowRow(table, catalog.getShow(id), true);
     }
-
-    cout << string(totalWidth, '-') << endl;
-    cout << longestShows.size() << " shows found." << endl;
+    printShowTable(table, format, "");
+    return true;
 }
 
-void minShow() {
-    if (programs.empty()) {
-        cout << "No shows available." << endl;
-        return;
+bool runQueryText(const string& text, bool explain, TableFormat format) {
+    OpTimer timer(Op::Query);
+    QueryPlan plan;
+    string error;
+    if (!compileQuery(text, catalog, plan, error)) {
+        cout << "Invalid query: " << error << endl;
+        return false;
+    }
+    if (explain) {
+        for (const auto& note : plan.notes) cout << note << endl;
+        return true;
     }
 
-    int minDuration = INT_MAX;
-    vector<show> shortestShows;
-
-    // First, find the minimum duration
-    for (const auto& s : programs) {
-        if (s.duration < minDuration) {
-            minDuration = s.duration;
+    // Candidate rows and group state come from the thread's scratch arena,
+    // which keeps its blocks from one query to the next
+    ScratchScope scratch;
+    QueryResult result = runQuery(plan, catalog, &scratch.arena());
+    if (plan.group == QueryGroup::None) {
+        Table table = showTable(true);
+        table.reserve(result.rows.size());
+        for (ShowId id : result.rows) {
+            addShowRow(table, catalog.getShow(id), true);
         }
+        printShowTable(table, format, "");
+        return true;
     }
 
-    // Then collect all shows with that duration
-    for (const auto& s : programs) {
-        if (s.duration == minDuration) {
-            shortestShows.push_back(s);
-        }
+    Table table({{"Group", "group"}, {"Shows", "shows", "", true}, {"Total", "total", " min", true},
+                 {"Average", "average", " min", true}, {"Min", "min", " min", true}, {"Max", "max", " min", true}});
+    table.reserve(result.groups.size());
+    for (const auto& g : result.groups) {
+        ostringstream average;
+        average << fixed << setprecision(1) << g.stats.average();
+        table.decodedCell(g.key).number(g.stats.count).number(g.stats.sum).cell(average.str())
+             .number(g.stats.min).number(g.stats.max);
     }
+    if (format == TableFormat::Text) cout << endl;
+    table.print(format);
+    if (format == TableFormat::Text) cout << table.rows() << " groups found." << endl;
+    return true;
+}
 
-    // First pass: determine needed column widths based on content
-    int nameWidth = 4;      // minimum width for "Name"
-    int categoryWidth = 8;  // minimum width for "Category"
-    int timeWidth = 10;     // minimum width for "Start Time"
-    int durationWidth = 8;  // minimum width for "Duration"
-    int dayWidth = 3;       // minimum width for "Day"
-    int channelWidth = 12;  // minimum width for "Channel Code"
-
-    // Determine maximum content width for each column
-    for (const auto& s : shortestShows) {
-        nameWidth = max(nameWidth, static_cast<int>(decode(s.name).length()));
-        categoryWidth = max(categoryWidth, static_cast<int>(decode(s.category).length()));
-        dayWidth = max(dayWidth, static_cast<int>(decode(s.dayOfWeek).length()));
-        channelWidth = max(channelWidth, static_cast<int>(s.channelCode.length()));
-
-        // Calculate duration string length and consider it for column width
-        string durationStr = to_string(s.duration) + " min";
-        durationWidth = max(durationWidth, static_cast<int>(durationStr.length()));
-
-        // Calculate time string length
-        string startTime = (s.startHour < 10 ? "0" + to_string(s.startHour) : to_string(s.startHour)) + ":" +
-                          (s.startMinute < 10 ? "0" + to_string(s.startMinute) : to_string(s.startMinute));
-        timeWidth = max(timeWidth, static_cast<int>(startTime.length()));
-    }
-
-    // Add padding (1 space on each side)
-    nameWidth += 2;
-    categoryWidth += 2;
-    timeWidth += 2;
-    durationWidth += 2;
-    dayWidth += 2;
-    channelWidth += 2;
-
-    // Print header
-    int totalWidth = nameWidth + categoryWidth + timeWidth + durationWidth + dayWidth + channelWidth + 7; // 7 for the separators
-    cout << endl << "Shows with the shortest duration (" << minDuration << " minutes):" << endl;
-    cout << string(totalWidth, '-') << endl;
-    cout << "|" << setw(nameWidth) << left << " Name"
-         << "|" << setw(categoryWidth) << " Category"
-         << "|" << setw(timeWidth) << " Start Time"
-         << "|" << setw(durationWidth) << " Duration"
-         << "|" << setw(dayWidth) << " Day"
-         << "|" << setw(channelWidth) << " Channel Code" << "|" << endl;
-    cout << string(totalWidth, '-') << endl;
+static const char* const searchTargetNames[] = {"Category", "Channel", "Show"};
 
-    // Print data rows
-    for (const auto& s : shortestShows) {
-        string name = decode(s.name);
-        string category = decode(s.category);
-        string day = decode(s.dayOfWeek);
-        string channelCode = s.channelCode;
-        string startTime = (s.startHour < 10 ? "0" + to_string(s.startHour) : to_string(s.startHour)) + ":" +
-                         (s.startMinute < 10 ? "0" + to_string(s.startMinute) : to_string(s.startMinute));
-        string durationStr = to_string(s.duration) + " min";
+static string describeMatch(const SearchMatch& m) {
+    string kind = matchKindName(m.kind);
+    return m.kind == MatchKind::Typo ? kind + " (" + to_string(m.typos) + ")" : kind;
+}
+
+void searchCatalog(const string& text, size_t limit, TableFormat format) {
+    OpTimer timer(Op::Search);
+    vector<SearchMatch> matches;
+    catalog.search(text, limit, matches);
+
+    Table table({{"Type", "type"}, {"Name", "name"}, {"Match", "match"}, {"Details", "details"}});
+    table.reserve(matches.size());
+    for (const auto& m : matches) {
+        table.cell(searchTargetNames[static_cast<size_t>(m.target)]);
+        if (m.target == SearchTarget::Show) {
+            const show& s = catalog.getShow(m.id);
+            table.decodedCell(s.name).cell(describeMatch(m))
+                 .cell(decode(categoryNames.str(s.category)) + ", " + dayName(s.dayOfWeek) + " " +
+                       formatStartTime(s.startHour, s.startMinute) + ", channel " + channelCodes.str(s.channelCode));
+        } else if (m.target == SearchTarget::Channel) {
+            const channel& c = catalog.getChannel(m.id);
+            table.decodedCell(c.name).cell(describeMatch(m)).cell("code " + c.code + ", " + decode(c.originCountry));
+        } else {
+            table.decodedCell(categoryNames.str(m.id)).cell(describeMatch(m))
+                 .cell(to_string(catalog.durations().category(m.id).count) + " shows");
+        }
+    }
+    if (format == TableFormat::Text) cout << endl;
+    table.print(format);
+    if (format == TableFormat::Text) cout << table.rows() << " matches found." << endl;
+}
 
-        cout << "|" << setw(nameWidth) << " " + name
-             << "|" << setw(categoryWidth) << " " + category
-             << "|" << setw(timeWidth) << " " + startTime
-             << "|" << setw(durationWidth) << " " + durationStr
-             << "|" << setw(dayWidth) << " " + day
-             << "|" << setw(channelWidth) << " " + channelCode << "|" << endl;
+void checkConflicts() {
+    OpTimer timer(Op::Report);
+    if (catalog.showCount() == 0) {
+        cout << "No shows available." << endl;
+        return;
     }
 
-    cout << string(totalWidth, '-') << endl;
-    cout << shortestShows.size() << " shows found." << endl;
+    vector<ScheduleConflict> conflicts = findScheduleConflicts(catalog);
+    if (conflicts.empty()) {
+        cout << "No overlapping shows found." << endl;
+        return;
+    }
+    for (const auto& c : conflicts) {
+        cout << describeShow(catalog.getShow(c.first)) << endl
+             << "  overlaps " << describeShow(catalog.getShow(c.second)) << endl;
+    }
+    cout << conflicts.size() << " conflicts found." << endl;
 }
 
-void averageShow(const string& category) {
-    int sum = 0, count = 0;
-    for (auto& s : programs) {
-        if (s.category == encode(category)) {
-            sum += s.duration;
-            count++;
+bool importShows(const string& path) {
+    OpTimer timer(Op::ImportShows);
+    if (path.empty()) {
+        cout << "Invalid input. Please provide a file name." << endl;
+        return false;
+    }
+    ProgramFileView file = viewPrograms(path);
+    if (!file.file.isOpen()) {
+        cout << "Error: could not open " << path << "." << endl;
+        return false;
+    }
+    if (!file.report.errors.empty()) {
+        printLoadReport(path, file.report);
+        cout << "Nothing imported." << endl;
+        return false;
+    }
+
+    // All shows go in together or not at all
+    CatalogBatch batch;
+    InternCache categories(categoryNames);
+    InternCache codes(channelCodes);
+    for (const auto& view : file.shows) {
+        batch.insertShow(toShow(view, categories, codes));
+    }
+    vector<string> errors;
+    if (!batch.commit(catalog, journal, errors)) {
+        const size_t shown = 10;
+        cout << "Import rejected, " << errors.size() << " problem(s):" << endl;
+        for (size_t i = 0; i < errors.size() && i < shown; ++i) {
+            cout << "  " << errors[i] << endl;
         }
+        if (errors.size() > shown) {
+            cout << "  ..." << endl;
+        }
+        return false;
     }
-    if (count == 0) {
-        cout << "No shows available in the " << category << " category." << endl;
-    } else {
-        double average = static_cast<double>(sum) / count;
-        cout << "Average duration of shows in category "  << category << ": " << average << " minutes." << endl;
+    compactJournalIfNeeded();
+    cout << "Imported " << file.shows.size() << " shows from " << path << "." << endl;
+    return true;
+}
+
+bool exportSnapshot(const string& path) {
+    if (path.empty()) {
+        cout << "Invalid input. Please provide a file name." << endl;
+        return false;
+    }
+    if (!writeSnapshot(path, catalog)) {
+        cout << "Error: could not write " << path << "." << endl;
+        return false;
     }
+    cout << "Exported " << catalog.showCount() << " shows and " << catalog.channelCount()
+         << " channels to " << path << "." << endl;
+    return true;
+}
+
+bool importSnapshot(const string& path) {
+    if (path.empty()) {
+        cout << "Invalid input. Please provide a file name." << endl;
+        return false;
+    }
+    string error;
+    Catalog imported;
+    if (!readSnapshot(path, imported, error)) {
+        cout << "Error: could not import " << path << ": " << error << "." << endl;
+        return false;
+    }
+    // The snapshot replaces everything, so it only takes over once the text
+    // files hold it. If one of them was written, put the old catalog back.
+    if (!journal.compact(imported)) {
+        journal.compact(catalog);
+        cout << "Error: could not write Program.txt/Channel.txt. Nothing was imported." << endl;
+        return false;
+    }
+    catalog = move(imported);
+    cout << "Imported " << catalog.showCount() << " shows and " << catalog.channelCount()
+         << " channels from " << path << "." << endl;
+    return true;
 }
 
 void showMenu() {
@@ -877,7 +1052,16 @@ void showMenu() {
         cout << "11. Show longest show" << endl;
         cout << "12. Show shortest show" << endl;
         cout << "13. Average show" << endl;
-        cout << "14. Exit" << endl;
+        cout << "14. Duration and operation statistics" << endl;
+        cout << "15. Export binary snapshot" << endl;
+        cout << "16. Import binary snapshot" << endl;
+        cout << "17. What's on" << endl;
+        cout << "18. Check schedule conflicts" << endl;
+        cout << "19. Import shows from file" << endl;
+        cout << "20. Query" << endl;
+        cout << "21. Search" << endl;
+        cout << "22. Shows on a channel" << endl;
+        cout << "23. Exit" << endl;
         cout << "Enter your choice: ";
 
         string input;
@@ -897,11 +1081,11 @@ void showMenu() {
         switch (choice) {
             case 1:
                 clearScreen();
-                allShows();
+                browseShows();
                 break;
             case 2:
                 clearScreen();
-                allChannels();
+                browseChannels();
                 break;
             case 3: {
                 clearScreen();
@@ -944,12 +1128,22 @@ void showMenu() {
                 getline(cin, name);
                 deleteShow(name);
                 break;
-            case 6:
+            case 6: {
                 clearScreen();
                 cout << "Enter name of channel to delete: ";
                 getline(cin, name);
-                deleteChannel(name);
+                ChannelId id = catalog.findChannelByName(encode(name));
+                size_t dependents = id == noChannel ? 0
+                                    : catalog.showsOnChannel(channelCodes.find(catalog.getChannel(id).code)).size();
+                bool cascade = false;
+                if (dependents > 0) {
+                    cout << "The channel has " << dependents << " shows. Delete them as well? (y/n): ";
+                    getline(cin, input);
+                    cascade = input == "y" || input == "Y";
+                }
+                deleteChannel(name, cascade);
                 break;
+            }
             case 7:
                 clearScreen();
                 cout << "Enter name of show to edit: ";
@@ -988,6 +1182,75 @@ void showMenu() {
                 break;
             case 14:
                 clearScreen();
+                durationSummary();
+                operationStats();
+                break;
+            case 15:
+                clearScreen();
+                cout << "Enter snapshot file name (e.g. Catalog.tvcs): ";
+                getline(cin, name);
+                exportSnapshot(name);
+                break;
+            case 16:
+                clearScreen();
+                cout << "Enter snapshot file name to import: ";
+                getline(cin, name);
+                importSnapshot(name);
+                break;
+            case 17: {
+                clearScreen();
+                string startTime;
+                cout << "Enter day of week: ";
+                getline(cin, dayOfWeek);
+                cout << "Enter time (HH:MM): ";
+                getline(cin, startTime);
+                cout << "Enter window length in minutes (0 for that moment only): ";
+                getline(cin, input);
+                try {
+                    duration = input.empty() ? 0 : stoi(input);
+                } catch (const exception&) {
+                    cout << "Invalid window length. Operation cancelled." << endl;
+                    break;
+                }
+                cout << "Enter channel code (empty for all channels): ";
+                getline(cin, channelCode);
+                whatsOn(dayOfWeek, startTime, duration, channelCode);
+                break;
+            }
+            case 18:
+                clearScreen();
+                checkConflicts();
+                break;
+            case 19:
+                clearScreen();
+                cout << "Enter file name (Program.txt format): ";
+                getline(cin, name);
+                importShows(name);
+                break;
+            case 20:
+                clearScreen();
+                cout << "Query (e.g. shows where day = Luni and duration >= 60 order by start): ";
+                getline(cin, input);
+                runQueryText(input, false);
+                break;
+            case 21:
+                clearScreen();
+                cout << "Search for (part of a show, channel or category name): ";
+                getline(cin, input);
+                searchCatalog(input, defaultSearchResults);
+                break;
+            case 22:
+                clearScreen();
+                cout << "Enter channel code: ";
+                getline(cin, channelCode);
+                channelShows(channelCode);
+                break;
+            case 23:
+                clearScreen();
+                // Leave Program.txt/Channel.txt up to date for the next start
+                if (journal.size() > 0 && !journal.compact(catalog)) {
+                    cout << "Warning: changes remain in Catalog.journal and will be replayed on next start." << endl;
+                }
                 cout << "Exiting program. Goodbye!" << endl;
                 break;
             default:
@@ -995,11 +1258,11 @@ void showMenu() {
                 break;
         }
         
-        if (choice != 14) {
+        if (choice != 23) {
             cout << "\nPress Enter to continue...";
             cin.get();
             clearScreen();
         }
-    } while (choice != 14);
+    } while (choice != 23);
 }
 
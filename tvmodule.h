@@ -3,28 +3,16 @@
 
 #include <string>
 #include <vector>
+#include "catalog.h"
+#include "journal.h"
+#include "table.h"
 
 using namespace std;
 
-struct show {
-    string name;
-    string category;
-    int startHour;
-    int startMinute;
-    int duration;        // in minutes
-    string dayOfWeek;
-    string channelCode;
-};
-
-struct channel {
-    string code;
-    string name;
-    string originCountry;
-};
-
-// Global containers
-extern vector<show> programs;
-extern vector<channel> channels;
+// Global catalog holding every show and channel, and the journal of changes
+// made to it since Program.txt/Channel.txt were last written
+extern Catalog catalog;
+extern Journal journal;
 
 // Screen utility
 void clearScreen();
@@ -34,23 +22,58 @@ bool fileExists(const string& fileName);
 void createFileIfNotExists(const string& fileName);
 
 // Display
-void allShows();
-void allChannels();
+void allShows(TableFormat format = TableFormat::Text);
+void allChannels(TableFormat format = TableFormat::Text);
 
-// CRUD operations
-void addShow(const string& name, const string& category, const string& startTime, int duration, const string& dayOfWeek, string channelCode);
-void addChannel(const string& name, const string& originCountry);
-void deleteShow(const string& name);
-void deleteChannel(const string& name);
-void editShow(const string& name, string newName = "", string newCategory = "", string newStartTime = "", int newDuration = 0, string newDayOfWeek = "", string newChannelCode = "");
-void editChannel(const string& name, string newName = "", string newOriginCountry = "");
+// Paged display: only the rows on the requested page are visited, so the
+// first page of a huge catalog comes up as fast as that of a small one
+constexpr size_t defaultPageSize = 50;
+void showsPage(size_t offset, size_t pageSize, TableFormat format = TableFormat::Text);
+void channelsPage(size_t offset, size_t pageSize, TableFormat format = TableFormat::Text);
+void browseShows(size_t pageSize = defaultPageSize);       // interactive, a page at a time
+void browseChannels(size_t pageSize = defaultPageSize);
+
+// CRUD operations. These, and the commands below that return bool, print why
+// they failed and return false.
+bool addShow(const string& name, const string& category, const string& startTime, int duration, const string& dayOfWeek, string channelCode);
+bool addChannel(const string& name, const string& originCountry);
+bool deleteShow(const string& name);
+bool deleteChannel(const string& name, bool cascade = false);     // refuses while shows are on it, unless cascade
+bool editShow(const string& name, string newName = "", string newCategory = "", string newStartTime = "", int newDuration = 0, string newDayOfWeek = "", string newChannelCode = "");
+bool editChannel(const string& name, string newName = "", string newOriginCountry = "");
 
 // Summaries and queries
-void broadcastSummary();
-void specificDayShow(const string& day);
-void maxShow();
-void minShow();
-void averageShow();
+bool broadcastSummary();
+bool specificDayShow(const string& day, TableFormat format = TableFormat::Text);
+bool channelShows(const string& channelCode, TableFormat format = TableFormat::Text);     // the channel's week in order
+void maxShow(TableFormat format = TableFormat::Text);
+void minShow(TableFormat format = TableFormat::Text);
+void averageShow(const string& category);
+void durationSummary();
+bool whatsOn(const string& day, const string& time, int windowMinutes, const string& channelCode,
+             TableFormat format = TableFormat::Text);
+void checkConflicts();
+
+// Calls, latency percentiles and I/O per operation since the program started
+// (see metrics.h)
+void operationStats(TableFormat format = TableFormat::Text);
+
+// Runs a query (see query.h for the language); explain prints the chosen plan
+// instead of the rows
+bool runQueryText(const string& text, bool explain, TableFormat format = TableFormat::Text);
+
+// Lists the categories, channels and shows whose names match the text best:
+// exactly, by prefix, by a later word's prefix, anywhere, or with a typo or
+// two (see search.h)
+constexpr size_t defaultSearchResults = 20;
+void searchCatalog(const string& text, size_t limit = defaultSearchResults, TableFormat format = TableFormat::Text);
+
+// Binary snapshot import/export
+bool exportSnapshot(const string& path);
+bool importSnapshot(const string& path);
+
+// Bulk import of Program.txt-format files as one all-or-nothing batch
+bool importShows(const string& path);
 
 // Menu
 void showMenu();
@@ -0,0 +1,52 @@
+#ifndef VERSIONS_H
+#define VERSIONS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "catalog.h"
+
+using namespace std;
+
+// Immutable, reference-counted catalog versions. A reader pins the current
+// version with one atomic load and may hold references into it for as long
+// as it keeps the pin, whatever writers do meanwhile. A writer drafts the
+// next version from the current one; the draft shares every index part it
+// does not touch (see cow.h), so it costs about as much as the columns. An
+// old version is freed as soon as the last reader pinning it lets go.
+class CatalogVersions {
+public:
+    explicit CatalogVersions(const Catalog& initial) { current.store(track(make_shared<Catalog>(initial))); }
+
+    shared_ptr<const Catalog> pin() const { return current.load(); }
+
+    // A private copy of the current version to apply changes to. Only one
+    // writer may draft and publish at a time.
+    shared_ptr<Catalog> draft() const { return track(make_shared<Catalog>(*pin())); }
+
+    void publish(shared_ptr<const Catalog> next) {
+        current.store(move(next));
+        number++;
+    }
+
+    uint64_t version() const { return number.load(); }
+    // Versions still pinned by someone, the current one included
+    size_t live() const { return alive->load(); }
+
+private:
+    // Counts the version in alive until its last owner releases it
+    shared_ptr<Catalog> track(shared_ptr<Catalog> version) const {
+        alive->fetch_add(1);
+        auto counter = alive;
+        return shared_ptr<Catalog>(version.get(), [version, counter](Catalog*) mutable {
+            version.reset();
+            counter->fetch_sub(1);
+        });
+    }
+
+    atomic<shared_ptr<const Catalog>> current;
+    atomic<uint64_t> number {0};
+    shared_ptr<atomic<size_t>> alive = make_shared<atomic<size_t>>(0);
+};
+
+#endif // VERSIONS_H